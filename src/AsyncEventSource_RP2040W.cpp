@@ -154,18 +154,25 @@ static String generateEventMessage(const char *message, const char *event, uint3
 // Message
 
 AsyncEventSourceMessage::AsyncEventSourceMessage(const char * data, size_t len)
-  : _data(nullptr), _len(len), _sent(0), _acked(0)
+  : _payload(nullptr), _len(len), _sent(0), _acked(0)
 {
-  _data = (uint8_t*)malloc(_len + 1);
+  _payload = AsyncWebSharedBuffer::create((const uint8_t *) data, len);
 
-  if (_data == nullptr)
+  if (_payload == nullptr)
   {
     _len = 0;
   }
-  else
+}
+
+/////////////////////////////////////////////////
+
+AsyncEventSourceMessage::AsyncEventSourceMessage(AsyncWebSharedBuffer * payload)
+  : _payload(nullptr), _len(0), _sent(0), _acked(0)
+{
+  if (payload != nullptr)
   {
-    memcpy(_data, data, len);
-    _data[_len] = 0;
+    _payload = payload->ref();
+    _len = payload->length();
   }
 }
 
@@ -173,8 +180,8 @@ AsyncEventSourceMessage::AsyncEventSourceMessage(const char * data, size_t len)
 
 AsyncEventSourceMessage::~AsyncEventSourceMessage()
 {
-  if (_data != NULL)
-    free(_data);
+  if (_payload != NULL)
+    _payload->unref();
 }
 
 /////////////////////////////////////////////////
@@ -205,12 +212,12 @@ size_t AsyncEventSourceMessage::send(AsyncClient *client)
 {
   const size_t len = _len - _sent;
 
-  if (client->space() < len)
+  if ((_payload == NULL) || (client->space() < len))
   {
     return 0;
   }
 
-  size_t sent = client->add((const char *)_data, len);
+  size_t sent = client->add((const char *)_payload->data() + _sent, len);
 
   if (client->canSend())
     client->send();
@@ -226,7 +233,7 @@ size_t AsyncEventSourceMessage::send(AsyncClient *client)
 // Client
 
 AsyncEventSourceClient::AsyncEventSourceClient(AsyncWebServerRequest *request, AsyncEventSource *server)
-  : _messageQueue(LinkedList<AsyncEventSourceMessage * >([](AsyncEventSourceMessage * m)
+  : _messageQueue(IntrusiveLinkedList<AsyncEventSourceMessage>([](AsyncEventSourceMessage * m)
 {
   delete  m;
 }))
@@ -267,7 +274,8 @@ AsyncEventSourceClient::AsyncEventSourceClient(AsyncWebServerRequest *request, A
 
   _server->_addClient(this);
 
-  delete request;
+  // Back to the server, deleted or pooled
+  request->_server->_handleDisconnect(request);
 }
 
 /////////////////////////////////////////////////
@@ -375,6 +383,14 @@ void AsyncEventSourceClient::write(const char * message, size_t len)
 
 /////////////////////////////////////////////////
 
+// The queued message takes its own reference to payload
+void AsyncEventSourceClient::write(AsyncWebSharedBuffer * payload)
+{
+  _queueMessage(new AsyncEventSourceMessage(payload));
+}
+
+/////////////////////////////////////////////////
+
 void AsyncEventSourceClient::send(const char *message, const char *event, uint32_t id, uint32_t reconnect)
 {
   AWS_LOGDEBUG5("AsyncEventSourceClient::send: message =", message, ", event =", event, ", id =", id);
@@ -505,13 +521,25 @@ void AsyncEventSource::send(const char *message, const char *event, uint32_t id,
 {
   String ev = generateEventMessage(message, event, id, reconnect);
 
+  // One copy of the event, whatever the number of clients
+  AsyncWebSharedBuffer * payload = AsyncWebSharedBuffer::create((const uint8_t *) ev.c_str(), ev.length());
+
+  if (payload == NULL)
+  {
+    AWS_LOGERROR("AsyncEventSource::send ERROR: out of memory");
+
+    return;
+  }
+
   for (const auto &c : _clients)
   {
     if (c->connected())
     {
-      c->write(ev.c_str(), ev.length());
+      c->write(payload);
     }
   }
+
+  payload->unref();
 }
 
 /////////////////////////////////////////////////
@@ -526,6 +554,16 @@ size_t AsyncEventSource::count() const
 
 /////////////////////////////////////////////////
 
+WebRouteType AsyncEventSource::route(String& pattern, WebRequestMethodComposite& methods)
+{
+  pattern = _url;
+  methods = HTTP_GET;
+
+  return ROUTE_EXACT;
+}
+
+/////////////////////////////////////////////////
+
 bool AsyncEventSource::canHandle(AsyncWebServerRequest *request)
 {
   if (request->method() != HTTP_GET || !request->url().equals(_url))
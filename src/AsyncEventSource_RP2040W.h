@@ -53,10 +53,11 @@ typedef std::function<void(AsyncEventSourceClient *client)> ArEventHandlerFuncti
 
 /////////////////////////////////////////////////
 
-class AsyncEventSourceMessage
+class AsyncEventSourceMessage : public LinkedListHook<AsyncEventSourceMessage>
 {
   private:
-    uint8_t * _data;
+    // Shared by every client the event was sent to, each message keeping its own offsets
+    AsyncWebSharedBuffer * _payload;
     size_t _len;
     size_t _sent;
     //size_t _ack;
@@ -64,6 +65,7 @@ class AsyncEventSourceMessage
 
   public:
     AsyncEventSourceMessage(const char * data, size_t len);
+    AsyncEventSourceMessage(AsyncWebSharedBuffer * payload);
     ~AsyncEventSourceMessage();
     size_t ack(size_t len, uint32_t time __attribute__((unused)));
     size_t send(AsyncClient *client);
@@ -92,7 +94,7 @@ class AsyncEventSourceClient
     AsyncClient *_client;
     AsyncEventSource *_server;
     uint32_t _lastId;
-    LinkedList<AsyncEventSourceMessage *> _messageQueue;
+    IntrusiveLinkedList<AsyncEventSourceMessage> _messageQueue;
     void _queueMessage(AsyncEventSourceMessage *dataMessage);
     void _runQueue();
 
@@ -112,6 +114,7 @@ class AsyncEventSourceClient
 
     void close();
     void write(const char * message, size_t len);
+    void write(AsyncWebSharedBuffer * payload);
     void send(const char *message, const char *event = NULL, uint32_t id = 0, uint32_t reconnect = 0);
 
     /////////////////////////////////////////////////
@@ -177,6 +180,7 @@ class AsyncEventSource: public AsyncWebHandler
     void _addClient(AsyncEventSourceClient * client);
     void _handleDisconnect(AsyncEventSourceClient * client);
     virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual WebRouteType route(String& pattern, WebRequestMethodComposite& methods) override final;
     virtual void handleRequest(AsyncWebServerRequest *request) override final;
 };
 
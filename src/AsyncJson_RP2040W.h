@@ -97,6 +97,13 @@ class ChunkPrint : public Print
 
     /////////////////////////////////////////////////
 
+    inline size_t written() const
+    {
+      return _pos;
+    }
+
+    /////////////////////////////////////////////////
+
     size_t write(uint8_t c)
     {
       if (_to_skip > 0)
@@ -126,6 +133,349 @@ class ChunkPrint : public Print
 
 /////////////////////////////////////////////////
 
+#ifndef ARDUINOJSON_5_COMPATIBILITY
+
+// Max depth of nested objects / arrays the serializer can resume from.
+// Deeper documents fall back to re-serializing with ChunkPrint
+#ifndef ASYNC_JSON_MAX_NESTING
+  #define ASYNC_JSON_MAX_NESTING      16
+#endif
+
+/*
+   Resumable serializer : keeps a cursor into the document between _fillBuffer() calls,
+   so that every byte of the response is produced only once.
+   Output is byte for byte the same as serializeJson() / serializeJsonPretty(),
+   as Content-Length comes from measureJson() / measureJsonPretty()
+ * */
+
+class AsyncJsonSerializer
+{
+  private:
+    struct Frame
+    {
+      bool isObject;
+      bool first;
+      JsonObjectConstIterator objIt;
+      JsonObjectConstIterator objEnd;
+      JsonArrayConstIterator  arrIt;
+      JsonArrayConstIterator  arrEnd;
+    };
+
+    JsonVariantConst _root;
+    JsonVariantConst _value;        // value following the key being written
+    Frame _stack[ASYNC_JSON_MAX_NESTING];
+    uint8_t _depth;
+    bool _pretty;
+    bool _started;
+    bool _done;
+    bool _hasValue;
+    bool _fallback;
+
+    // String (key or value) being escaped into the output
+    const char* _str;
+    bool _strIsKey;
+
+    // Small token (punctuation, indentation, number, literal, split escape sequence) being written
+    char _pending[64];
+    uint8_t _pendingLen;
+    uint8_t _pendingPos;
+
+    size_t _total;
+
+    /////////////////////////////////////////////////
+
+    static char _escape(char c)
+    {
+      // Same escape table as ArduinoJson TextFormatter
+      switch (c)
+      {
+        case '"':
+          return '"';
+
+        case '\\':
+          return '\\';
+
+        case '\b':
+          return 'b';
+
+        case '\f':
+          return 'f';
+
+        case '\n':
+          return 'n';
+
+        case '\r':
+          return 'r';
+
+        case '\t':
+          return 't';
+
+        default:
+          return 0;
+      }
+    }
+
+    /////////////////////////////////////////////////
+
+    inline void _push(const char* s)
+    {
+      while (*s && _pendingLen < sizeof(_pending))
+        _pending[_pendingLen++] = *s++;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline void _indent(uint8_t depth)
+    {
+      for (uint8_t i = 0; i < depth; i++)
+        _push("  ");
+    }
+
+    /////////////////////////////////////////////////
+
+    void _writeValue(JsonVariantConst value)
+    {
+      if (value.is<JsonObjectConst>() || value.is<JsonArrayConst>())
+      {
+        const bool isObject = value.is<JsonObjectConst>();
+        JsonObjectConst object = value.as<JsonObjectConst>();
+        JsonArrayConst  array  = value.as<JsonArrayConst>();
+
+        if (isObject ? (object.begin() == object.end()) : (array.begin() == array.end()))
+        {
+          _push(isObject ? "{}" : "[]");
+
+          return;
+        }
+
+        if (_depth >= ASYNC_JSON_MAX_NESTING)
+        {
+          _fallback = true;
+
+          return;
+        }
+
+        Frame& f = _stack[_depth++];
+
+        f.isObject = isObject;
+        f.first    = true;
+
+        if (isObject)
+        {
+          f.objIt  = object.begin();
+          f.objEnd = object.end();
+        }
+        else
+        {
+          f.arrIt  = array.begin();
+          f.arrEnd = array.end();
+        }
+
+        _push(isObject ? "{" : "[");
+
+        if (_pretty)
+          _push("\r\n");
+
+        return;
+      }
+
+      if (value.is<const char*>() && value.as<const char*>())
+      {
+        _str      = value.as<const char*>();
+        _strIsKey = false;
+        _push("\"");
+
+        return;
+      }
+
+      // Numbers, booleans, null and short raw values
+      if (measureJson(value) >= sizeof(_pending) - _pendingLen)
+      {
+        _fallback = true;
+
+        return;
+      }
+
+      _pendingLen += serializeJson(value, _pending + _pendingLen, sizeof(_pending) - _pendingLen);
+    }
+
+    /////////////////////////////////////////////////
+
+    void _next()
+    {
+      _pendingLen = 0;
+      _pendingPos = 0;
+
+      if (!_started)
+      {
+        _started = true;
+        _writeValue(_root);
+      }
+      else if (_hasValue)
+      {
+        _hasValue = false;
+        _writeValue(_value);
+      }
+      else if (_depth == 0)
+      {
+        _done = true;
+      }
+      else
+      {
+        Frame& f = _stack[_depth - 1];
+
+        if (f.isObject ? (f.objIt != f.objEnd) : (f.arrIt != f.arrEnd))
+        {
+          if (!f.first)
+            _push(_pretty ? ",\r\n" : ",");
+
+          f.first = false;
+
+          if (_pretty)
+            _indent(_depth);
+
+          if (f.isObject)
+          {
+            JsonPairConst pair = *f.objIt;
+            ++f.objIt;
+
+            _str      = pair.key().c_str();
+            _strIsKey = true;
+            _value    = pair.value();
+            _hasValue = true;
+            _push("\"");
+          }
+          else
+          {
+            JsonVariantConst value = *f.arrIt;
+            ++f.arrIt;
+
+            _writeValue(value);
+          }
+        }
+        else
+        {
+          _depth--;
+
+          if (_pretty)
+          {
+            _push("\r\n");
+            _indent(_depth);
+          }
+
+          _push(f.isObject ? "}" : "]");
+        }
+      }
+    }
+
+  public:
+    AsyncJsonSerializer(bool pretty = false)
+      : _depth(0), _pretty(pretty), _started(false), _done(false), _hasValue(false), _fallback(false),
+        _str(nullptr), _strIsKey(false), _pendingLen(0), _pendingPos(0), _total(0) {}
+
+    /////////////////////////////////////////////////
+
+    inline void setPretty(bool pretty)
+    {
+      _pretty = pretty;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Write the next (up to) len bytes of the serialized document into data, returns the bytes written
+    size_t fill(JsonVariantConst root, uint8_t* data, size_t len)
+    {
+      size_t pos = 0;
+
+      if (!_started)
+        _root = root;
+
+      while (pos < len)
+      {
+        if (_pendingPos < _pendingLen)
+        {
+          const size_t n = std::min((size_t)(_pendingLen - _pendingPos), len - pos);
+
+          memcpy(data + pos, _pending + _pendingPos, n);
+          _pendingPos += n;
+          pos += n;
+        }
+        else if (_str)
+        {
+          while (pos < len && *_str)
+          {
+            const char e = _escape(*_str);
+
+            if (!e)
+            {
+              data[pos++] = *_str++;
+            }
+            else if (len - pos >= 2)
+            {
+              data[pos++] = '\\';
+              data[pos++] = e;
+              _str++;
+            }
+            else
+            {
+              // Escape sequence split across two buffers
+              _pending[0]  = '\\';
+              _pending[1]  = e;
+              _pendingLen  = 2;
+              _pendingPos  = 0;
+              _str++;
+
+              break;
+            }
+          }
+
+          if (_pendingPos == _pendingLen && !*_str)
+          {
+            // closing quote
+            _pendingLen = 0;
+            _pendingPos = 0;
+            _push("\"");
+
+            if (_strIsKey)
+              _push(_pretty ? ": " : ":");
+
+            _str = nullptr;
+          }
+        }
+        else if (_fallback)
+        {
+          // Too deep or too long to resume : slow path, skip what has already been sent
+          ChunkPrint dest(data + pos, _total + pos, len - pos);
+
+          if (_pretty)
+            serializeJsonPretty(_root, dest);
+          else
+            serializeJson(_root, dest);
+
+          pos += dest.written();
+
+          break;
+        }
+        else if (_done)
+        {
+          break;
+        }
+        else
+        {
+          _next();
+        }
+      }
+
+      _total += pos;
+
+      return pos;
+    }
+};
+
+#endif    // ARDUINOJSON_5_COMPATIBILITY
+
+/////////////////////////////////////////////////
+
 class AsyncJsonResponse: public AsyncAbstractResponse
 {
   protected:
@@ -139,6 +489,10 @@ class AsyncJsonResponse: public AsyncAbstractResponse
     JsonVariant _root;
     bool _isValid;
 
+#ifndef ARDUINOJSON_5_COMPATIBILITY
+    AsyncJsonSerializer _serializer;
+#endif
+
   public:
 
     /////////////////////////////////////////////////
@@ -216,14 +570,15 @@ class AsyncJsonResponse: public AsyncAbstractResponse
 
     size_t _fillBuffer(uint8_t *data, size_t len)
     {
+#ifdef ARDUINOJSON_5_COMPATIBILITY
       ChunkPrint dest(data, _sentLength, len);
 
-#ifdef ARDUINOJSON_5_COMPATIBILITY
       _root.printTo( dest ) ;
+
+      return len;
 #else
-      serializeJson(_root, dest);
+      return _serializer.fill(_root, data, len);
 #endif
-      return len;
     }
 
     /////////////////////////////////////////////////
@@ -240,7 +595,10 @@ class PrettyAsyncJsonResponse: public AsyncJsonResponse
     PrettyAsyncJsonResponse (bool isArray = false) : AsyncJsonResponse {isArray} {}
 #else
     PrettyAsyncJsonResponse (bool isArray = false,
-                             size_t maxJsonBufferSize = DYNAMIC_JSON_DOCUMENT_SIZE) : AsyncJsonResponse {isArray, maxJsonBufferSize} {}
+                             size_t maxJsonBufferSize = DYNAMIC_JSON_DOCUMENT_SIZE) : AsyncJsonResponse {isArray, maxJsonBufferSize}
+    {
+      _serializer.setPretty(true);
+    }
 #endif
 
     /////////////////////////////////////////////////
@@ -263,18 +621,16 @@ class PrettyAsyncJsonResponse: public AsyncJsonResponse
 
     /////////////////////////////////////////////////
 
+#ifdef ARDUINOJSON_5_COMPATIBILITY
     size_t _fillBuffer (uint8_t *data, size_t len)
     {
       ChunkPrint dest (data, _sentLength, len);
 
-#ifdef ARDUINOJSON_5_COMPATIBILITY
       _root.prettyPrintTo (dest);
-#else
-      serializeJsonPretty(_root, dest);
-#endif
 
       return len;
     }
+#endif
 };
 
 /////////////////////////////////////////////////
@@ -0,0 +1,228 @@
+/****************************************************************************************************************************
+  AsyncWebArena_RP2040W.h
+
+  For RP2040W with CYW43439 WiFi
+
+  AsyncWebServer_RP2040W is a library for the RP2040W with CYW43439 WiFi
+
+  Based on and modified from ESPAsyncWebServer (https://github.com/me-no-dev/ESPAsyncWebServer)
+  Built by Khoi Hoang https://github.com/khoih-prog/AsyncWebServer_RP2040W
+  Licensed under GPLv3 license
+
+  Version: 1.5.0
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      13/08/2022 Initial coding for RP2040W with CYW43439 WiFi
+  ...
+  1.3.0   K Hoang      10/10/2022 Fix crash when using AsyncWebSockets server
+  1.3.1   K Hoang      10/10/2022 Improve robustness of AsyncWebSockets server
+  1.4.0   K Hoang      20/10/2022 Add LittleFS functions such as AsyncFSWebServer
+  1.4.1   K Hoang      10/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.4.2   K Hoang      28/01/2023 Add Async_AdvancedWebServer_SendChunked_MQTT and AsyncWebServer_MQTT_RP2040W examples
+  1.5.0   K Hoang      30/01/2023 Fix _catchAllHandler not working bug
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef RP2040W_ASYNCWEBARENA_H_
+#define RP2040W_ASYNCWEBARENA_H_
+
+#include "stddef.h"
+#include <new>
+#include <utility>
+
+/////////////////////////////////////////////////
+
+// Size of each block of the per-request arena. 0 => no arena, request objects use new / delete
+#ifndef REQUEST_ARENA_BLOCK_SIZE
+  #define REQUEST_ARENA_BLOCK_SIZE      512
+#endif
+
+/////////////////////////////////////////////////
+
+/*
+   ARENA :: Bump allocator owned by one request. Headers, params and path params of the request
+   are carved out of a few blocks, and all given back at once when the request ends
+ * */
+
+class AsyncWebArena
+{
+  private:
+    struct Block
+    {
+      Block* next;
+      size_t size;
+      size_t used;
+    };
+
+    static const size_t ALIGN = sizeof(void*) * 2;
+
+    Block*  _blocks;      // current block first
+    size_t  _used;        // bytes handed out since the last reset()
+    size_t  _peak;
+    uint8_t _count;       // blocks malloc'ed since the last reset()
+
+    /////////////////////////////////////////////////
+
+    static inline size_t _align(size_t size)
+    {
+      return (size + ALIGN - 1) & ~(ALIGN - 1);
+    }
+
+    /////////////////////////////////////////////////
+
+    static inline uint8_t* _data(Block* b)
+    {
+      return (uint8_t*) b + _align(sizeof(Block));
+    }
+
+  public:
+    AsyncWebArena() : _blocks(NULL), _used(0), _peak(0), _count(0) {}
+
+    /////////////////////////////////////////////////
+
+    ~AsyncWebArena()
+    {
+      while (_blocks)
+      {
+        Block* b = _blocks;
+        _blocks = b->next;
+        ::free(b);
+      }
+    }
+
+    /////////////////////////////////////////////////
+
+    // NULL if REQUEST_ARENA_BLOCK_SIZE is 0, or out of heap
+    void* allocate(size_t size)
+    {
+      if (REQUEST_ARENA_BLOCK_SIZE == 0)
+        return NULL;
+
+      size = _align(size);
+
+      if (!_blocks || (_blocks->used + size > _blocks->size))
+      {
+        const size_t blockSize = (size > REQUEST_ARENA_BLOCK_SIZE) ? size : REQUEST_ARENA_BLOCK_SIZE;
+        Block* b = (Block*) malloc(_align(sizeof(Block)) + blockSize);
+
+        if (b == NULL)
+          return NULL;
+
+        b->next = _blocks;
+        b->size = blockSize;
+        b->used = 0;
+        _blocks = b;
+        _count++;
+      }
+
+      void* p = _data(_blocks) + _blocks->used;
+
+      _blocks->used += size;
+      _used += size;
+
+      if (_used > _peak)
+        _peak = _used;
+
+      return p;
+    }
+
+    /////////////////////////////////////////////////
+
+    char* strdup(const char* str, size_t len)
+    {
+      char* p = (char*) allocate(len + 1);
+
+      if (p)
+      {
+        memcpy(p, str, len);
+        p[len] = 0;
+      }
+
+      return p;
+    }
+
+    /////////////////////////////////////////////////
+
+    bool owns(const void* p) const
+    {
+      for (Block* b = _blocks; b; b = b->next)
+      {
+        if ( ((const uint8_t*) p >= _data(b)) && ((const uint8_t*) p < _data(b) + b->size) )
+          return true;
+      }
+
+      return false;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Constructed in the arena, or with new if the arena can't grow
+    template<typename T, typename... Args>
+    T* create(Args&& ... args)
+    {
+      void* p = allocate(sizeof(T));
+
+      if (p)
+        return new (p) T(std::forward<Args>(args)...);
+
+      return new T(std::forward<Args>(args)...);
+    }
+
+    /////////////////////////////////////////////////
+
+    template<typename T>
+    void destroy(T* p)
+    {
+      if (p == NULL)
+        return;
+
+      if (owns(p))
+        p->~T();
+      else
+        delete p;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Give back everything, keeping the first block for the next request on the connection
+    void reset()
+    {
+      while (_blocks && _blocks->next)
+      {
+        Block* b = _blocks;
+        _blocks = b->next;
+        ::free(b);
+      }
+
+      if (_blocks)
+        _blocks->used = 0;
+
+      _used  = 0;
+      _count = _blocks ? 1 : 0;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline size_t used() const
+    {
+      return _used;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline size_t peak() const
+    {
+      return _peak;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline uint8_t blocks() const
+    {
+      return _count;
+    }
+};
+
+#endif /* RP2040W_ASYNCWEBARENA_H_ */
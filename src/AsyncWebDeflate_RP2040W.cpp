@@ -0,0 +1,640 @@
+/****************************************************************************************************************************
+  AsyncWebDeflate_RP2040W.cpp
+
+  For RP2040W with CYW43439 WiFi
+
+  AsyncWebServer_RP2040W is a library for the RP2040W with CYW43439 WiFi
+
+  Based on and modified from ESPAsyncWebServer (https://github.com/me-no-dev/ESPAsyncWebServer)
+  Built by Khoi Hoang https://github.com/khoih-prog/AsyncWebServer_RP2040W
+  Licensed under GPLv3 license
+
+  Version: 1.5.0
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      13/08/2022 Initial coding for RP2040W with CYW43439 WiFi
+  ...
+  1.3.0   K Hoang      10/10/2022 Fix crash when using AsyncWebSockets server
+  1.3.1   K Hoang      10/10/2022 Improve robustness of AsyncWebSockets server
+  1.4.0   K Hoang      20/10/2022 Add LittleFS functions such as AsyncFSWebServer
+  1.4.1   K Hoang      10/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.4.2   K Hoang      28/01/2023 Add Async_AdvancedWebServer_SendChunked_MQTT and AsyncWebServer_MQTT_RP2040W examples
+  1.5.0   K Hoang      30/01/2023 Fix _catchAllHandler not working bug
+ *****************************************************************************************************************************/
+
+#if !defined(_RP2040W_AWS_LOGLEVEL_)
+  #define _RP2040W_AWS_LOGLEVEL_     1
+#endif
+
+/////////////////////////////////////////////////
+
+#include "AsyncWebServer_RP2040W_Debug.h"
+
+#include "AsyncWebDeflate_RP2040W.h"
+
+/////////////////////////////////////////////////
+
+// Base values and extra bits of length codes 257..285 and distance codes 0..29, RFC 1951 3.2.5
+static const uint16_t deflateLengthBase[29]  = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51,
+                                                 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+                                               };
+static const uint8_t  deflateLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+                                                 5, 5, 5, 5, 0
+                                               };
+static const uint16_t deflateDistBase[30]    = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513,
+                                                 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+                                               };
+static const uint8_t  deflateDistExtra[30]   = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10,
+                                                 11, 11, 12, 12, 13, 13
+                                               };
+
+// Order of the code length code lengths in a dynamic block header
+static const uint8_t  deflateCodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+#define DEFLATE_MAX_MATCH       258
+#define DEFLATE_MIN_MATCH       3
+
+/////////////////////////////////////////////////
+/////////////////////////////////////////////////
+
+/*
+   Compressor : greedy LZ77 over a single entry hash table, fixed Huffman codes
+*/
+
+typedef struct
+{
+  uint8_t * out;
+  size_t    size;
+  size_t    pos;
+  uint32_t  bits;
+  uint8_t   count;
+  bool      overflow;
+} DeflateWriter;
+
+/////////////////////////////////////////////////
+
+static void deflatePutBits(DeflateWriter * w, uint32_t value, uint8_t count)
+{
+  w->bits  |= value << w->count;
+  w->count += count;
+
+  while (w->count >= 8)
+  {
+    if (w->pos < w->size)
+      w->out[w->pos++] = (uint8_t) w->bits;
+    else
+      w->overflow = true;
+
+    w->bits  >>= 8;
+    w->count -= 8;
+  }
+}
+
+/////////////////////////////////////////////////
+
+// Huffman codes are sent most significant bit first, the rest of the stream least significant bit first
+static inline uint16_t deflateReverse(uint16_t code, uint8_t len)
+{
+  uint16_t reversed = 0;
+
+  while (len--)
+  {
+    reversed = (reversed << 1) | (code & 1);
+    code >>= 1;
+  }
+
+  return reversed;
+}
+
+/////////////////////////////////////////////////
+
+static void deflatePutSymbol(DeflateWriter * w, uint16_t symbol)
+{
+  if (symbol < 144)
+    deflatePutBits(w, deflateReverse(0x30 + symbol, 8), 8);
+  else if (symbol < 256)
+    deflatePutBits(w, deflateReverse(0x190 + (symbol - 144), 9), 9);
+  else if (symbol < 280)
+    deflatePutBits(w, deflateReverse(symbol - 256, 7), 7);
+  else
+    deflatePutBits(w, deflateReverse(0xC0 + (symbol - 280), 8), 8);
+}
+
+/////////////////////////////////////////////////
+
+static void deflatePutMatch(DeflateWriter * w, size_t length, size_t distance)
+{
+  uint8_t code = 28;
+
+  while (deflateLengthBase[code] > length)
+    code--;
+
+  deflatePutSymbol(w, 257 + code);
+  deflatePutBits(w, length - deflateLengthBase[code], deflateLengthExtra[code]);
+
+  code = 29;
+
+  while (deflateDistBase[code] > distance)
+    code--;
+
+  // Fixed distance codes are plain 5-bit numbers
+  deflatePutBits(w, deflateReverse(code, 5), 5);
+  deflatePutBits(w, distance - deflateDistBase[code], deflateDistExtra[code]);
+}
+
+/////////////////////////////////////////////////
+
+static inline uint32_t deflateHash(const uint8_t * data)
+{
+  uint32_t key = ((uint32_t) data[0] << 16) | ((uint32_t) data[1] << 8) | data[2];
+
+  return (uint32_t)(key * 2654435761U) >> (32 - DEFLATE_HASH_BITS);
+}
+
+/////////////////////////////////////////////////
+
+size_t AsyncWebDeflate::compress(const uint8_t * data, size_t len, uint8_t * out, size_t outSize, uint8_t windowBits)
+{
+  // Positions are kept modulo 64K : every candidate is checked byte by byte, a stale one only costs a compare
+  uint16_t * table = (uint16_t *) malloc(sizeof(uint16_t) << DEFLATE_HASH_BITS);
+
+  if (table == NULL)
+  {
+    AWS_LOGDEBUG("Could not malloc deflate hash table");
+
+    return 0;
+  }
+
+  memset(table, 0, sizeof(uint16_t) << DEFLATE_HASH_BITS);
+
+  DeflateWriter w = { out, outSize, 0, 0, 0, false };
+  const size_t window = (size_t) 1 << windowBits;
+  size_t i = 0;
+
+  // BFINAL = 0, BTYPE = 01 : fixed Huffman codes
+  deflatePutBits(&w, 0x02, 3);
+
+  while ((i < len) && !w.overflow)
+  {
+    size_t length   = 0;
+    size_t distance = 0;
+
+    if (i + DEFLATE_MIN_MATCH <= len)
+    {
+      uint32_t hash = deflateHash(data + i);
+
+      distance    = (uint16_t)(i - table[hash]);
+      table[hash] = (uint16_t) i;
+
+      if (distance && (distance <= window) && (distance <= i))
+      {
+        const uint8_t * match = data + i - distance;
+        size_t maxLength      = std::min((size_t) DEFLATE_MAX_MATCH, len - i);
+
+        while ((length < maxLength) && (match[length] == data[i + length]))
+          length++;
+      }
+    }
+
+    if (length >= DEFLATE_MIN_MATCH)
+    {
+      deflatePutMatch(&w, length, distance);
+
+      // Index the positions inside the match too, later matches may start there
+      for (size_t j = i + 1; (j < i + length) && (j + DEFLATE_MIN_MATCH <= len); j++)
+        table[deflateHash(data + j)] = (uint16_t) j;
+
+      i += length;
+    }
+    else
+    {
+      deflatePutSymbol(&w, data[i]);
+      i++;
+    }
+  }
+
+  // End of block, then the header of the empty stored block of a sync flush. Its LEN / NLEN,
+  // 0x00 0x00 0xFF 0xFF, are left for the receiver to append
+  deflatePutSymbol(&w, 256);
+  deflatePutBits(&w, 0, 3);
+  deflatePutBits(&w, 0, (8 - w.count) & 7);
+
+  free(table);
+
+  return w.overflow ? 0 : w.pos;
+}
+
+/////////////////////////////////////////////////
+/////////////////////////////////////////////////
+
+/*
+   Decompressor : canonical Huffman decoding one bit at a time, as in zlib's puff.c
+*/
+
+typedef struct
+{
+  uint16_t count[16];
+  uint16_t symbol[288];
+} InflateHuffman;
+
+typedef struct
+{
+  const uint8_t * in;
+  size_t          inLen;
+  size_t          inPos;
+  uint32_t        bits;
+  uint8_t         count;
+  bool            error;
+
+  uint8_t *       out;
+  size_t          outPos;
+  size_t          outSize;
+  size_t          outMax;
+
+  InflateHuffman  lencode;
+  InflateHuffman  distcode;
+  uint8_t         lengths[320];
+} InflateState;
+
+/////////////////////////////////////////////////
+
+static uint32_t inflateBits(InflateState * s, uint8_t need)
+{
+  uint32_t value = s->bits;
+
+  while (s->count < need)
+  {
+    if (s->inPos == s->inLen)
+    {
+      s->error = true;
+
+      return 0;
+    }
+
+    value |= (uint32_t) s->in[s->inPos++] << s->count;
+    s->count += 8;
+  }
+
+  s->bits   = value >> need;
+  s->count -= need;
+
+  return value & ((1UL << need) - 1);
+}
+
+/////////////////////////////////////////////////
+
+// Make room for len more bytes plus the null terminator
+static bool inflateRoom(InflateState * s, size_t len)
+{
+  if (s->outPos + len > s->outMax)
+  {
+    AWS_LOGDEBUG1("Inflated message too long, max =", s->outMax);
+
+    return false;
+  }
+
+  if (s->outPos + len + 1 <= s->outSize)
+    return true;
+
+  size_t size = std::max(s->outSize * 2, s->outPos + len + 1);
+
+  if (size > s->outMax + 1)
+    size = s->outMax + 1;
+
+  uint8_t * out = (uint8_t *) realloc(s->out, size);
+
+  if (out == NULL)
+  {
+    AWS_LOGDEBUG1("Could not realloc inflate buffer, bytes =", size);
+
+    return false;
+  }
+
+  s->out     = out;
+  s->outSize = size;
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+// Returns false for an over-subscribed set of lengths
+static bool inflateBuild(InflateHuffman * h, const uint8_t * lengths, uint16_t n)
+{
+  uint16_t offsets[16];
+  int left = 1;
+
+  memset(h->count, 0, sizeof(h->count));
+
+  for (uint16_t symbol = 0; symbol < n; symbol++)
+    h->count[lengths[symbol]]++;
+
+  for (uint8_t len = 1; len < 16; len++)
+  {
+    left <<= 1;
+    left -= h->count[len];
+
+    if (left < 0)
+      return false;
+  }
+
+  offsets[1] = 0;
+
+  for (uint8_t len = 1; len < 15; len++)
+    offsets[len + 1] = offsets[len] + h->count[len];
+
+  for (uint16_t symbol = 0; symbol < n; symbol++)
+  {
+    if (lengths[symbol])
+      h->symbol[offsets[lengths[symbol]]++] = symbol;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+static int inflateDecode(InflateState * s, const InflateHuffman * h)
+{
+  int code  = 0;
+  int first = 0;
+  int index = 0;
+
+  for (uint8_t len = 1; len < 16; len++)
+  {
+    code |= inflateBits(s, 1);
+
+    if (s->error)
+      return -1;
+
+    int count = h->count[len];
+
+    if (code - count < first)
+      return h->symbol[index + (code - first)];
+
+    index += count;
+    first += count;
+    first <<= 1;
+    code  <<= 1;
+  }
+
+  return -1;
+}
+
+/////////////////////////////////////////////////
+
+static bool inflateStored(InflateState * s)
+{
+  // Drop the rest of the current byte
+  s->bits  = 0;
+  s->count = 0;
+
+  if (s->inPos + 4 > s->inLen)
+    return false;
+
+  size_t len  = s->in[s->inPos] | (s->in[s->inPos + 1] << 8);
+  size_t nlen = s->in[s->inPos + 2] | (s->in[s->inPos + 3] << 8);
+
+  s->inPos += 4;
+
+  if ((len != (~nlen & 0xFFFF)) || (s->inPos + len > s->inLen) || !inflateRoom(s, len))
+    return false;
+
+  memcpy(s->out + s->outPos, s->in + s->inPos, len);
+
+  s->inPos  += len;
+  s->outPos += len;
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+static bool inflateCodes(InflateState * s)
+{
+  for (;;)
+  {
+    int symbol = inflateDecode(s, &s->lencode);
+
+    if (symbol < 0)
+      return false;
+
+    if (symbol < 256)
+    {
+      if (!inflateRoom(s, 1))
+        return false;
+
+      s->out[s->outPos++] = (uint8_t) symbol;
+    }
+    else if (symbol == 256)
+    {
+      return true;
+    }
+    else
+    {
+      symbol -= 257;
+
+      if (symbol >= 29)
+        return false;
+
+      size_t length = deflateLengthBase[symbol] + inflateBits(s, deflateLengthExtra[symbol]);
+
+      symbol = inflateDecode(s, &s->distcode);
+
+      if ((symbol < 0) || (symbol >= 30))
+        return false;
+
+      size_t distance = deflateDistBase[symbol] + inflateBits(s, deflateDistExtra[symbol]);
+
+      // Back references may reach into the history in front of this message
+      if (s->error || (distance > s->outPos) || !inflateRoom(s, length))
+        return false;
+
+      uint8_t * to         = s->out + s->outPos;
+      const uint8_t * from = to - distance;
+
+      s->outPos += length;
+
+      // Byte by byte : when distance < length the copy repeats the bytes it has just written
+      while (length--)
+        *to++ = *from++;
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+
+static bool inflateFixed(InflateState * s)
+{
+  uint16_t symbol = 0;
+
+  for (; symbol < 144; symbol++)
+    s->lengths[symbol] = 8;
+
+  for (; symbol < 256; symbol++)
+    s->lengths[symbol] = 9;
+
+  for (; symbol < 280; symbol++)
+    s->lengths[symbol] = 7;
+
+  for (; symbol < 288; symbol++)
+    s->lengths[symbol] = 8;
+
+  inflateBuild(&s->lencode, s->lengths, 288);
+
+  memset(s->lengths, 5, 30);
+  inflateBuild(&s->distcode, s->lengths, 30);
+
+  return inflateCodes(s);
+}
+
+/////////////////////////////////////////////////
+
+static bool inflateDynamic(InflateState * s)
+{
+  uint16_t nlen  = inflateBits(s, 5) + 257;
+  uint16_t ndist = inflateBits(s, 5) + 1;
+  uint16_t ncode = inflateBits(s, 4) + 4;
+
+  if (s->error || (nlen > 286) || (ndist > 30))
+    return false;
+
+  uint16_t index = 0;
+
+  memset(s->lengths, 0, 19);
+
+  for (; index < ncode; index++)
+    s->lengths[deflateCodeLengthOrder[index]] = inflateBits(s, 3);
+
+  if (s->error || !inflateBuild(&s->lencode, s->lengths, 19))
+    return false;
+
+  index = 0;
+
+  while (index < nlen + ndist)
+  {
+    int symbol = inflateDecode(s, &s->lencode);
+
+    if (symbol < 0)
+      return false;
+
+    if (symbol < 16)
+    {
+      s->lengths[index++] = symbol;
+    }
+    else
+    {
+      uint8_t len = 0;
+
+      if (symbol == 16)
+      {
+        if (index == 0)
+          return false;
+
+        len    = s->lengths[index - 1];
+        symbol = 3 + inflateBits(s, 2);
+      }
+      else if (symbol == 17)
+        symbol = 3 + inflateBits(s, 3);
+      else
+        symbol = 11 + inflateBits(s, 7);
+
+      if (s->error || (index + symbol > nlen + ndist))
+        return false;
+
+      while (symbol--)
+        s->lengths[index++] = len;
+    }
+  }
+
+  // No end of block code, the block could never end
+  if (s->lengths[256] == 0)
+    return false;
+
+  if (!inflateBuild(&s->lencode, s->lengths, nlen) || !inflateBuild(&s->distcode, s->lengths + nlen, ndist))
+    return false;
+
+  return inflateCodes(s);
+}
+
+/////////////////////////////////////////////////
+
+uint8_t * AsyncWebDeflate::inflate(const uint8_t * data, size_t len, const uint8_t * history, size_t historyLen,
+                                   size_t maxLen, size_t * outLen)
+{
+  InflateState * s = (InflateState *) malloc(sizeof(InflateState));
+
+  if (s == NULL)
+  {
+    AWS_LOGDEBUG("Could not malloc inflate state");
+
+    return NULL;
+  }
+
+  s->in      = data;
+  s->inLen   = len;
+  s->inPos   = 0;
+  s->bits    = 0;
+  s->count   = 0;
+  s->error   = false;
+  s->outPos  = historyLen;
+  s->outMax  = historyLen + maxLen;
+  s->outSize = historyLen + std::min(maxLen, std::max(len * 4, (size_t) 256)) + 1;
+  s->out     = (uint8_t *) malloc(s->outSize);
+
+  bool ok   = (s->out != NULL);
+  bool last = false;
+
+  if (ok && historyLen)
+    memcpy(s->out, history, historyLen);
+
+  while (ok && !last)
+  {
+    // A message normally ends with the empty stored block of a sync flush, not with a final block
+    if ((s->inPos == s->inLen) && (s->count < 8))
+      break;
+
+    last = inflateBits(s, 1);
+
+    switch (inflateBits(s, 2))
+    {
+      case 0:
+        ok = inflateStored(s);
+        break;
+
+      case 1:
+        ok = inflateFixed(s);
+        break;
+
+      case 2:
+        ok = inflateDynamic(s);
+        break;
+
+      default:
+        ok = false;
+        break;
+    }
+
+    ok = ok && !s->error;
+  }
+
+  uint8_t * out = s->out;
+
+  if (ok)
+  {
+    out[s->outPos] = 0;
+    *outLen = s->outPos - historyLen;
+  }
+  else
+  {
+    AWS_LOGDEBUG1("Inflate error at input byte", s->inPos);
+
+    free(out);
+    out = NULL;
+  }
+
+  free(s);
+
+  return out;
+}
@@ -0,0 +1,74 @@
+/****************************************************************************************************************************
+  AsyncWebDeflate_RP2040W.h
+
+  For RP2040W with CYW43439 WiFi
+
+  AsyncWebServer_RP2040W is a library for the RP2040W with CYW43439 WiFi
+
+  Based on and modified from ESPAsyncWebServer (https://github.com/me-no-dev/ESPAsyncWebServer)
+  Built by Khoi Hoang https://github.com/khoih-prog/AsyncWebServer_RP2040W
+  Licensed under GPLv3 license
+
+  Version: 1.5.0
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      13/08/2022 Initial coding for RP2040W with CYW43439 WiFi
+  ...
+  1.3.0   K Hoang      10/10/2022 Fix crash when using AsyncWebSockets server
+  1.3.1   K Hoang      10/10/2022 Improve robustness of AsyncWebSockets server
+  1.4.0   K Hoang      20/10/2022 Add LittleFS functions such as AsyncFSWebServer
+  1.4.1   K Hoang      10/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.4.2   K Hoang      28/01/2023 Add Async_AdvancedWebServer_SendChunked_MQTT and AsyncWebServer_MQTT_RP2040W examples
+  1.5.0   K Hoang      30/01/2023 Fix _catchAllHandler not working bug
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef RP2040W_ASYNCWEBDEFLATE_H_
+#define RP2040W_ASYNCWEBDEFLATE_H_
+
+#include "Arduino.h"
+
+/////////////////////////////////////////////////
+
+// Entries (2 bytes each) of the LZ77 match finder hash table, allocated for each compress() call
+#ifndef DEFLATE_HASH_BITS
+  #define DEFLATE_HASH_BITS       10
+#endif
+
+/////////////////////////////////////////////////
+
+/*
+   Raw DEFLATE (RFC 1951) as used by permessage-deflate (RFC 7692).
+
+   compress() writes one fixed Huffman block ending in a sync flush, with the trailing
+   0x00 0x00 0xFF 0xFF removed, so each message stands alone (no context takeover).
+
+   inflate() decodes a whole message, stored, fixed or dynamic blocks, the caller having
+   appended the 0x00 0x00 0xFF 0xFF tail. Back references may reach into history, the
+   window kept from previous messages when the peer uses context takeover.
+*/
+class AsyncWebDeflate
+{
+  public:
+    // Worst case compressed size of len bytes
+    static inline size_t bound(size_t len)
+    {
+      return len + (len >> 3) + 8;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Returns the compressed length, or 0 if the result doesn't fit in outSize
+    static size_t compress(const uint8_t * data, size_t len, uint8_t * out, size_t outSize, uint8_t windowBits);
+
+    // Returns a malloc()ed buffer holding history, then the *outLen decoded bytes and a null terminator,
+    // or NULL if the data is invalid or decodes to more than maxLen bytes
+    static uint8_t * inflate(const uint8_t * data, size_t len, const uint8_t * history, size_t historyLen,
+                             size_t maxLen, size_t * outLen);
+};
+
+/////////////////////////////////////////////////
+
+#endif    // RP2040W_ASYNCWEBDEFLATE_H_
@@ -36,6 +36,40 @@
 
 #include "stddef.h"
 #include <time.h>
+#include <vector>
+
+/////////////////////////////////////////////////
+
+// Number of files whose metadata is kept by each AsyncStaticWebHandler
+#ifndef STATIC_FILE_CACHE_SIZE
+  #define STATIC_FILE_CACHE_SIZE          8
+#endif
+
+// ms before a cached file is checked again against the file system (size and last write time)
+#ifndef STATIC_FILE_CACHE_REVALIDATE
+  #define STATIC_FILE_CACHE_REVALIDATE    2000
+#endif
+
+// Largest file whose ETag is a CRC32 of its content, read while the request is handled.
+// Bigger files get an ETag from their size and last write time, or none if the file system has no time
+#ifndef STATIC_ETAG_MAX_CRC_SIZE
+  #define STATIC_ETAG_MAX_CRC_SIZE        16384
+#endif
+
+/////////////////////////////////////////////////
+
+typedef struct
+{
+  String    path;           // path on the file system, without ".gz"
+  String    contentType;
+  String    etag;           // strong ETag, computed the first time the file is sent
+  size_t    size;
+  time_t    lastWrite;
+  uint32_t  checked;        // millis() of the last check against the file system
+  uint32_t  used;           // to find the least recently used entry
+  bool      exists;
+  bool      gzip;
+} AsyncStaticFileInfo;
 
 /////////////////////////////////////////////////
 
@@ -45,6 +79,9 @@ class AsyncStaticWebHandler: public AsyncWebHandler
     bool    _getFile(AsyncWebServerRequest *request);
     bool    _fileExists(AsyncWebServerRequest *request, const String& path);
     uint8_t   _countBits(const uint8_t value) const;
+    AsyncStaticFileInfo* _fileInfo(const String& path);
+    AsyncStaticFileInfo* _findFileInfo(const String& path);
+    String  _computeETag(File& file, time_t lastWrite) const;
 
   protected:
     FS      _fs;
@@ -57,11 +94,14 @@ class AsyncStaticWebHandler: public AsyncWebHandler
     bool    _isDir;
     bool    _gzipFirst;
     uint8_t _gzipStats;
+    std::vector<AsyncStaticFileInfo> _fileCache;
+    uint32_t _fileCacheUse;
 
   public:
     AsyncStaticWebHandler(const char* uri, FS& fs, const char* path, const char* cache_control);
     virtual bool canHandle(AsyncWebServerRequest *request) override final;
     virtual void handleRequest(AsyncWebServerRequest *request) override final;
+    virtual WebRouteType route(String& pattern, WebRequestMethodComposite& methods) override final;
     AsyncStaticWebHandler& setIsDir(bool isDir);
     AsyncStaticWebHandler& setDefaultFile(const char* filename);
     AsyncStaticWebHandler& setCacheControl(const char* cache_control);
@@ -71,6 +111,10 @@ class AsyncStaticWebHandler: public AsyncWebHandler
     AsyncStaticWebHandler& setLastModified(time_t last_modified);
     AsyncStaticWebHandler& setLastModified(); //sets to current time. Make sure sntp is runing and time is updated
 
+    // Forget the cached metadata of all files, or of one file (path on the file system), after changing them
+    void invalidate();
+    void invalidate(const String& path);
+
     /////////////////////////////////////////////////
 
     AsyncStaticWebHandler& setTemplateProcessor(AwsTemplateProcessor newCallback)
@@ -93,10 +137,74 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
     ArUploadHandlerFunction   _onUpload;
     ArBodyHandlerFunction     _onBody;
     bool _isRegex;
+    bool _isPathTemplate;
+
+#ifdef ASYNCWEBSERVER_REGEX
+    std::regex* _regex;
+#endif
+
+    // Kind of match and string to compare the url with, worked out once in setUri()
+    WebRouteType _uriType;
+    String _uriTemplate;
+
+    /////////////////////////////////////////////////
+
+    // Match url against a path template such as "/api/{id}/value". Each {name} matches one
+    // non empty url segment. Path params are added to request, if not NULL
+    static bool _matchPathTemplate(const char* pattern, const char* url, AsyncWebServerRequest *request)
+    {
+      while (*pattern)
+      {
+        if (*pattern == '{')
+        {
+          const char* start = url;
+
+          while (*url && *url != '/')
+            url++;
+
+          if (url == start)
+            return false;
+
+          if (request)
+          {
+            String param;
+
+            param.concat(start, url - start);
+            request->_addPathParam(param.c_str());
+          }
+
+          while (*pattern && *pattern != '}')
+            pattern++;
+
+          if (*pattern)
+            pattern++;
+        }
+        else if (*pattern++ != *url++)
+        {
+          return false;
+        }
+      }
+
+      return (*url == 0);
+    }
 
   public:
     AsyncCallbackWebHandler() : _uri(), _method(HTTP_ANY), _onRequest(NULL), _onUpload(NULL), _onBody(NULL),
-      _isRegex(false) {}
+      _isRegex(false), _isPathTemplate(false),
+#ifdef ASYNCWEBSERVER_REGEX
+      _regex(NULL),
+#endif
+      _uriType(ROUTE_PREFIX), _uriTemplate() {}
+
+    /////////////////////////////////////////////////
+
+#ifdef ASYNCWEBSERVER_REGEX
+    virtual ~AsyncCallbackWebHandler()
+    {
+      if (_regex)
+        delete _regex;
+    }
+#endif
 
     /////////////////////////////////////////////////
 
@@ -104,6 +212,55 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
     {
       _uri = uri;
       _isRegex = uri.startsWith("^") && uri.endsWith("$");
+
+      // "/api/{id}/value"
+      const int brace = _isRegex ? -1 : _uri.indexOf('{');
+      _isPathTemplate = (brace >= 0) && (_uri.indexOf('}', brace) > 0);
+
+      if (_isPathTemplate)
+      {
+        // The literal part before the first {name} is what the route index can use
+        _uriType = ROUTE_PREFIX;
+        _uriTemplate = _uri.substring(0, brace);
+      }
+      else if (_uri.length() == 0)
+      {
+        // Matches everything
+        _uriType = ROUTE_PREFIX;
+        _uriTemplate = String();
+      }
+      else if (_uri.startsWith("/*."))
+      {
+        _uriType = ROUTE_EXTENSION;
+        _uriTemplate = _uri.substring(_uri.lastIndexOf("."));
+      }
+      else if (_uri.endsWith("*"))
+      {
+        _uriType = ROUTE_PREFIX;
+        _uriTemplate = _uri.substring(0, _uri.length() - 1);
+      }
+      else
+      {
+        _uriType = ROUTE_PATH;
+        _uriTemplate = _uri;
+      }
+
+#ifdef ASYNCWEBSERVER_REGEX
+
+      if (_regex)
+      {
+        delete _regex;
+        _regex = NULL;
+      }
+
+      if (_isRegex)
+      {
+        // Compile once here, not for every request
+        _uriType = ROUTE_CUSTOM;
+        _regex = new std::regex(_uri.c_str());
+      }
+
+#endif
     }
 
     /////////////////////////////////////////////////
@@ -150,13 +307,11 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
         
 #ifdef ASYNCWEBSERVER_REGEX
 
-      if (_isRegex)
+      if (_regex)
       {
-        std::regex pattern(_uri.c_str());
-        std::smatch matches;
-        std::string s(request->url().c_str());
-        
-        if (std::regex_search(s, matches, pattern))
+        std::cmatch matches;
+
+        if (std::regex_search(request->url().c_str(), matches, *_regex))
         {
           for (size_t i = 1; i < matches.size(); ++i)
           {
@@ -171,26 +326,30 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
       }
       else
 #endif
-      if (_uri.length() && _uri.startsWith("/*.")) 
+      if (_isPathTemplate)
       {
-         String uriTemplate = String (_uri);
-         uriTemplate = uriTemplate.substring(uriTemplate.lastIndexOf("."));
-                  
-         if (!request->url().endsWith(uriTemplate))
-           return false;
+        // Check first, so that a failed match doesn't leave path params behind
+        if (!_matchPathTemplate(_uri.c_str(), request->url().c_str(), NULL))
+          return false;
+
+        _matchPathTemplate(_uri.c_str(), request->url().c_str(), request);
       }
-      else if (_uri.length() && _uri.endsWith("*"))
+      else if (_uriType == ROUTE_EXTENSION)
       {
-        String uriTemplate = String(_uri);
-        uriTemplate = uriTemplate.substring(0, uriTemplate.length() - 1);
-        
-        if (!request->url().startsWith(uriTemplate))
+        if (!request->url().endsWith(_uriTemplate))
           return false;
       }
-      else if (_uri.length() && (_uri != request->url() && !request->url().startsWith(_uri + "/")))
-      {        
+      else if (_uriType == ROUTE_PREFIX)
+      {
+        if (!request->url().startsWith(_uriTemplate))
+          return false;
+      }
+      else if ( !request->url().startsWith(_uriTemplate)
+                || (request->url().length() != _uriTemplate.length() && request->url()[_uriTemplate.length()] != '/') )
+      {
+        // ROUTE_PATH : same url, or url starting with _uri + "/"
         return false;
-      }  
+      }
         
       request->addInterestingHeader("ANY");
 
@@ -233,6 +392,16 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
     {
       return _onRequest ? false : true;
     }
+
+    /////////////////////////////////////////////////
+
+    virtual WebRouteType route(String& pattern, WebRequestMethodComposite& methods) override final
+    {
+      pattern = _uriTemplate;
+      methods = _method;
+
+      return _uriType;
+    }
 };
 
 #endif /* RP2040W_ASYNCWEBSERVERHANDLERIMPL_H_ */
@@ -36,7 +36,7 @@
 
 AsyncStaticWebHandler::AsyncStaticWebHandler(const char* uri, FS& fs, const char* path, const char* cache_control)
   : _fs(fs), _uri(uri), _path(path), _default_file("index.htm"), _cache_control(cache_control), _last_modified(""),
-    _callback(nullptr)
+    _callback(nullptr), _fileCacheUse(0)
 {
   // Ensure leading '/'
   if (_uri.length() == 0 || _uri[0] != '/')
@@ -148,6 +148,9 @@ bool AsyncStaticWebHandler::canHandle(AsyncWebServerRequest *request)
     if (_cache_control.length())
       request->addInterestingHeader("If-None-Match");
 
+    // Files are served with Accept-Ranges: bytes
+    request->addInterestingHeader("Range");
+    request->addInterestingHeader("If-Range");
 
     AWS_LOGDEBUG("AsyncStaticWebHandler::canHandle OK");
 
@@ -159,6 +162,16 @@ bool AsyncStaticWebHandler::canHandle(AsyncWebServerRequest *request)
 
 /////////////////////////////////////////////////
 
+WebRouteType AsyncStaticWebHandler::route(String& pattern, WebRequestMethodComposite& methods)
+{
+  pattern = _uri;
+  methods = HTTP_GET;
+
+  return ROUTE_PREFIX;
+}
+
+/////////////////////////////////////////////////
+
 bool AsyncStaticWebHandler::_getFile(AsyncWebServerRequest *request)
 {
   // Remove the found uri
@@ -195,44 +208,128 @@ bool AsyncStaticWebHandler::_getFile(AsyncWebServerRequest *request)
 
 bool AsyncStaticWebHandler::_fileExists(AsyncWebServerRequest *request, const String& path)
 {
+  AsyncStaticFileInfo* info = _fileInfo(path);
+
+  if (info->exists)
+  {
+    // Extract the file name from the path and keep it in _tempObject
+    size_t pathLen = path.length();
+    char * _tempPath = (char*)malloc(pathLen + 1);
+    snprintf(_tempPath, pathLen + 1, "%s", path.c_str());
+    request->_tempObject = (void*)_tempPath;
+  }
+
+  return info->exists;
+}
+
+/////////////////////////////////////////////////
+
+AsyncStaticFileInfo* AsyncStaticWebHandler::_findFileInfo(const String& path)
+{
+  for (auto& info : _fileCache)
+  {
+    if (info.path == path)
+      return &info;
+  }
+
+  return nullptr;
+}
+
+/////////////////////////////////////////////////
+
+// Metadata of path, from the cache while it is fresh, so requests for known (or missing) files don't touch the file system
+AsyncStaticFileInfo* AsyncStaticWebHandler::_fileInfo(const String& path)
+{
+  AsyncStaticFileInfo* info = _findFileInfo(path);
+
+  if (info && (millis() - info->checked) < STATIC_FILE_CACHE_REVALIDATE)
+  {
+    info->used = ++_fileCacheUse;
+
+    return info;
+  }
+
   bool fileFound = false;
   bool gzipFound = false;
+  File file;
 
   String gzip = path + ".gz";
 
   if (_gzipFirst)
   {
-    request->_tempFile = _fs.open(gzip, "r");
-    gzipFound = FILE_IS_REAL(request->_tempFile);
+    file = _fs.open(gzip, "r");
+    gzipFound = FILE_IS_REAL(file);
 
     if (!gzipFound)
     {
-      request->_tempFile = _fs.open(path, "r");
-      fileFound = FILE_IS_REAL(request->_tempFile);
+      file = _fs.open(path, "r");
+      fileFound = FILE_IS_REAL(file);
     }
   }
   else
   {
-    request->_tempFile = _fs.open(path, "r");
-    fileFound = FILE_IS_REAL(request->_tempFile);
+    file = _fs.open(path, "r");
+    fileFound = FILE_IS_REAL(file);
 
     if (!fileFound)
     {
-      request->_tempFile = _fs.open(gzip, "r");
-      gzipFound = FILE_IS_REAL(request->_tempFile);
+      file = _fs.open(gzip, "r");
+      gzipFound = FILE_IS_REAL(file);
     }
   }
 
   bool found = fileFound || gzipFound;
 
+  size_t size       = found ? file.size() : 0;
+  time_t lastWrite  = found ? file.getLastWrite() : 0;
+
   if (found)
+    file.close();
+
+  if (info && info->exists == found && info->gzip == gzipFound && info->size == size && info->lastWrite == lastWrite)
   {
-    // Extract the file name from the path and keep it in _tempObject
-    size_t pathLen = path.length();
-    char * _tempPath = (char*)malloc(pathLen + 1);
-    snprintf(_tempPath, pathLen + 1, "%s", path.c_str());
-    request->_tempObject = (void*)_tempPath;
+    // Unchanged, keep the ETag
+    info->checked = millis();
+    info->used = ++_fileCacheUse;
+
+    return info;
+  }
 
+  if (!info)
+  {
+    if (_fileCache.size() < STATIC_FILE_CACHE_SIZE)
+    {
+      _fileCache.resize(_fileCache.size() + 1);
+      info = &_fileCache.back();
+    }
+    else
+    {
+      // Replace the least recently used entry
+      info = &_fileCache[0];
+
+      for (auto& entry : _fileCache)
+      {
+        if (entry.used < info->used)
+          info = &entry;
+      }
+    }
+
+    info->path = path;
+    info->contentType = AsyncFileResponse::contentTypeFor(path);
+  }
+
+  AWS_LOGDEBUG1("AsyncStaticWebHandler::_fileInfo: checked ", path);
+
+  info->etag      = String();
+  info->size      = size;
+  info->lastWrite = lastWrite;
+  info->checked   = millis();
+  info->used      = ++_fileCacheUse;
+  info->exists    = found;
+  info->gzip      = gzipFound;
+
+  if (found)
+  {
     // Calculate gzip statistic
     _gzipStats = (_gzipStats << 1) + (gzipFound ? 1 : 0);
 
@@ -244,7 +341,69 @@ bool AsyncStaticWebHandler::_fileExists(AsyncWebServerRequest *request, const St
       _gzipFirst = _countBits(_gzipStats) > 4; // IF we have more gzip files - try gzip first
   }
 
-  return found;
+  return info;
+}
+
+/////////////////////////////////////////////////
+
+// Strong ETag : CRC32 of the content and its size, or size and last write time above STATIC_ETAG_MAX_CRC_SIZE.
+// Empty if neither is usable. Leaves the file at its start
+String AsyncStaticWebHandler::_computeETag(File& file, time_t lastWrite) const
+{
+  char etag[32];
+
+  if (file.size() > STATIC_ETAG_MAX_CRC_SIZE)
+  {
+    // Too long to read here, LittleFS only has a last write time once the clock is set
+    if (!lastWrite)
+      return String();
+
+    snprintf(etag, sizeof(etag), "\"%x-t%lx\"", (unsigned int) file.size(), (unsigned long) lastWrite);
+
+    return String(etag);
+  }
+
+  static const uint32_t crcTable[16] =
+  {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+
+  uint8_t buf[128];
+  uint32_t crc = 0xFFFFFFFF;
+  size_t len;
+
+  while ((len = file.read(buf, sizeof(buf))) > 0)
+  {
+    for (size_t i = 0; i < len; i++)
+    {
+      crc = crcTable[(crc ^ buf[i]) & 0x0F] ^ (crc >> 4);
+      crc = crcTable[(crc ^ (buf[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+  }
+
+  file.seek(0, SeekSet);
+
+  snprintf(etag, sizeof(etag), "\"%x-%08lx\"", (unsigned int) file.size(), (unsigned long) ~crc);
+
+  return String(etag);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncStaticWebHandler::invalidate()
+{
+  _fileCache.clear();
+}
+
+/////////////////////////////////////////////////
+
+void AsyncStaticWebHandler::invalidate(const String& path)
+{
+  AsyncStaticFileInfo* info = _findFileInfo(path);
+
+  if (info)
+    info->checked = millis() - STATIC_FILE_CACHE_REVALIDATE;
 }
 
 /////////////////////////////////////////////////
@@ -259,44 +418,54 @@ void AsyncStaticWebHandler::handleRequest(AsyncWebServerRequest *request)
   if ((_username != "" && _password != "") && !request->authenticate(_username.c_str(), _password.c_str()))
     return request->requestAuthentication();
 
-  if (request->_tempFile == true)
+  // Just checked by canHandle(), normally still cached
+  AsyncStaticFileInfo* info = _fileInfo(filename);
+
+  if (!info->exists)
+  {
+    request->send(404);
+  }
+  else if (_last_modified.length() && _last_modified == request->header("If-Modified-Since"))
+  {
+    request->send(304); // Not modified
+  }
+  else if (_cache_control.length() && info->etag.length() && request->hasHeader("If-None-Match") &&
+           (request->header("If-None-Match").indexOf(info->etag) >= 0 || request->header("If-None-Match") == "*"))
   {
-    String etag = String(request->_tempFile.size());
+    AsyncWebServerResponse * response = new AsyncBasicResponse(304); // Not modified
 
-    if (_last_modified.length() && _last_modified == request->header("If-Modified-Since"))
-    {
-      request->_tempFile.close();
-      request->send(304); // Not modified
-    }
-    else if (_cache_control.length() && request->hasHeader("If-None-Match") &&
-             request->header("If-None-Match").equals(etag))
+    response->addHeader("Cache-Control", _cache_control);
+    response->addHeader("ETag", info->etag);
+    request->send(response);
+  }
+  else
+  {
+    File file = _fs.open(info->gzip ? filename + ".gz" : filename, "r");
+
+    if (!FILE_IS_REAL(file))
     {
-      request->_tempFile.close();
-      AsyncWebServerResponse * response = new AsyncBasicResponse(304); // Not modified
+      invalidate(filename);
 
-      response->addHeader("Cache-Control", _cache_control);
-      response->addHeader("ETag", etag);
-      request->send(response);
+      return request->send(404);
     }
-    else
-    {
-      AsyncWebServerResponse * response = new AsyncFileResponse(request->_tempFile, filename, String(), false, _callback);
 
-      if (_last_modified.length())
-        response->addHeader("Last-Modified", _last_modified);
+    if (_cache_control.length() && !info->etag.length())
+      info->etag = _computeETag(file, info->lastWrite);
 
-      if (_cache_control.length())
-      {
-        response->addHeader("Cache-Control", _cache_control);
-        response->addHeader("ETag", etag);
-      }
+    AsyncWebServerResponse * response = new AsyncFileResponse(file, filename, info->contentType, false, _callback);
+
+    if (_last_modified.length())
+      response->addHeader("Last-Modified", _last_modified);
+
+    if (_cache_control.length())
+    {
+      response->addHeader("Cache-Control", _cache_control);
 
-      request->send(response);
+      if (info->etag.length())
+        response->addHeader("ETag", info->etag);
     }
-  }
-  else
-  {
-    request->send(404);
+
+    request->send(response);
   }
 }
 
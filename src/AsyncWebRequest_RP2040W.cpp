@@ -47,22 +47,36 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   : _client(c), _server(s), _handler(NULL), _response(NULL), _temp(), _parseState(0)
   , _version(0), _method(HTTP_ANY), _url(), _host(), _contentType(), _boundary()
   , _authorization(), _reqconntype(RCT_HTTP), _isDigest(false), _isMultipart(false)
-  , _isPlainPost(false), _expectingContinue(false), _contentLength(0), _parsedLength(0)
-  , _headers(LinkedList<AsyncWebHeader * >([](AsyncWebHeader * h)
-{
-  delete h;
+  , _isPlainPost(false), _expectingContinue(false), _hasContentLength(false)
+  , _badRequest(false), _contentLength(0), _parsedLength(0)
+  , _keepAlive(false), _connectionClose(false), _connectionKeepAlive(false), _transferEncoding(false)
+  , _requestCount(0), _emptyLines(0), _pipelineBuffer(NULL), _pipelineLength(0), _rawHeaders(NULL), _rawHeadersTail(NULL)
+  , _headersFiltered(false)
+  , _headers(IntrusiveLinkedList<AsyncWebHeader>([this](AsyncWebHeader * h)
+{
+  _arena.destroy(h);
 }))
-, _params(LinkedList<AsyncWebParameter *>([](AsyncWebParameter *p)
+, _params(IntrusiveLinkedList<AsyncWebParameter>([this](AsyncWebParameter *p)
 {
-  delete p;
+  _arena.destroy(p);
 }))
-, _pathParams(LinkedList<String *>([](String *p)
+, _pathParams(LinkedList<String *>([this](String *p)
 {
-  delete p;
+  _arena.destroy(p);
 }))
 , _multiParseState(0), _boundaryPosition(0), _itemStartIndex(0), _itemSize(0), _itemName(), _itemFilename(), _itemType()
-, _itemValue(), _itemBuffer(0), _itemBufferIndex(0), _itemIsFile(false), _tempObject(NULL)
+, _itemValue(), _itemIsFile(false)
+, _uploadSink(NULL), _uploadSinkActive(false), _uploadRequestPending(false), _uploadUnacked(0), _pooled(false), _tempObject(NULL)
+{
+  _attach(c);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::_attach(AsyncClient* c)
 {
+  _client = c;
+
   c->onError([](void *r, AsyncClient * c, int8_t error)
   {
     RP2040W_AWS_UNUSED(c);
@@ -110,6 +124,10 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
 
 AsyncWebServerRequest::~AsyncWebServerRequest()
 {
+  // Not for the idle end of a persistent connection, already counted in _recycle(), nor for an idle pooled request
+  if ( _client && ((_parseState != PARSE_REQ_START) || !_requestCount) )
+    _server->_updateMemoryStats(_arena);
+
   _headers.free();
 
   _params.free();
@@ -126,50 +144,83 @@ AsyncWebServerRequest::~AsyncWebServerRequest()
   {
     free(_tempObject);
   }
+
+  if (_pipelineBuffer != NULL)
+  {
+    free(_pipelineBuffer);
+  }
+
+  if (_uploadSink != NULL)
+  {
+    delete _uploadSink;
+  }
 }
 
 /////////////////////////////////////////////////
 
 void AsyncWebServerRequest::_onData(void *buf, size_t len)
+{
+  _parseData(buf, len, len);
+}
+
+/////////////////////////////////////////////////
+
+// received is the part of buf AsyncClient acks after _onData() returns, 0 for pipelined data already acked
+void AsyncWebServerRequest::_parseData(void *buf, size_t len, size_t received)
 {
   size_t i = 0;
 
+  if ((_parseState == PARSE_REQ_START) && _requestCount && !_temp.length())
+  {
+    // First bytes of the next request on a persistent connection, stop the idle timeout
+    _client->setRxTimeout(0);
+  }
+
   while (true)
   {
-    if (_parseState < PARSE_REQ_BODY)
+    if (_parseState == PARSE_REQ_END)
     {
-      // Find new line in buf
-      char *str = (char*)buf;
-
-      for (i = 0; i < len; i++)
+      // Pipelined request arriving while the current response is still being sent.
+      // Keep it until the response is finished, see _recycle()
+      if (_keepAlive && !_bufferPipelined((uint8_t*)buf, len))
       {
-        if (str[i] == '\n')
-        {
-          break;
-        }
+        AWS_LOGERROR("_onData: pipeline overflow");
+
+        _keepAlive = false;
+        _client->close();
       }
+    }
+    else if (_parseState < PARSE_REQ_BODY)
+    {
+      // Find new line in buf
+      const char *str = (const char*)buf;
+      const char *nl  = (const char*) memchr(str, '\n', len);
 
-      if (i == len)
+      if (nl == NULL)
       {
-        // No new line, just add the buffer in _temp
-        char ch = str[len - 1];
-        str[len - 1] = 0;
-        _temp.reserve(_temp.length() + len);
-        _temp.concat(str);
-        _temp.concat(ch);
+        // No new line, keep the start of the line in _temp
+        _temp.concat(str, len);
       }
       else
       {
-        // Found new line - extract it and parse
-        str[i] = 0; // Terminate the string at the end of the line.
-        _temp.concat(str);
-        _temp.trim();
-        _parseLine();
+        // Found new line - parse it in place, unless its start came in a previous buffer
+        i = nl - str;
+
+        if (_temp.length())
+        {
+          _temp.concat(str, i);
+          _parseLine(_temp.c_str(), _temp.length());
+          _temp = String();
+        }
+        else
+        {
+          _parseLine(str, i);
+        }
 
         if (++i < len)
         {
           // Still have more buffer to process
-          buf = str + i;
+          buf = (uint8_t*)buf + i;
           len -= i;
           continue;
         }
@@ -181,18 +232,19 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len)
       // If handler does nothing (_onRequest is NULL), we don't need to really parse the body.
       const bool needParse = _handler && !_handler->isRequestHandlerTrivial();
 
+      // Bytes past the body belong to the next (pipelined) request
+      size_t pipelined = 0;
+
+      if (_parsedLength + len > _contentLength)
+      {
+        pipelined = _parsedLength + len - _contentLength;
+        len -= pipelined;
+      }
+
       if (_isMultipart)
       {
         if (needParse)
-        {
-          size_t i;
-
-          for (i = 0; i < len; i++)
-          {
-            _parseMultipartPostByte(((uint8_t*)buf)[i], i == len - 1);
-            _parsedLength++;
-          }
-        }
+          _parseMultipartPost((uint8_t*)buf, len);
         else
           _parsedLength += len;
       }
@@ -245,49 +297,167 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len)
       {
         _parseState = PARSE_REQ_END;
 
-        //check if authenticated before calling handleRequest and request auth instead
-        if (_handler)
-          _handler->handleRequest(this);
-
+        // Data still queued in the upload sink is written first, see _uploadFlush()
+        if (_uploadSink && !_uploadSink->done())
+          _uploadRequestPending = true;
         else
-        {
-          AWS_LOGERROR("_onData: 501");
-          
-          send(501);
-        }
+          _handleRequest();
+      }
+
+      if (pipelined)
+      {
+        buf = (uint8_t*)buf + len;
+        len = pipelined;
+
+        continue;
       }
     }
 
     break;
   }
 
+  if (_uploadSink)
+    _uploadFlush(received);
+
   // KH, Important for RP2040W, or system will hang
   yield();
 }
 
 /////////////////////////////////////////////////
 
-void AsyncWebServerRequest::_removeNotInterestingHeaders()
+void AsyncWebServerRequest::_handleRequest()
 {
-  if (_interestingHeaders.containsIgnoreCase("ANY"))
-    return; // nothing to do
+  //check if authenticated before calling handleRequest and request auth instead
+  if (_handler)
+    _handler->handleRequest(this);
+
+  else
+  {
+    AWS_LOGERROR("_onData: 501");
+
+    send(501);
+  }
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::setUploadSink(AwsUploadSinkWriter writer, AwsUploadSinkEnd onEnd, size_t blockSize)
+{
+  if (_uploadSink)
+  {
+    // One sink at a time : what the previous one can't write now is lost
+    _uploadSink->flush();
+    _uploadFlush();
+    delete _uploadSink;
+  }
+
+  _uploadSink = new AsyncWebUploadSink(writer, onEnd, blockSize);
+  _uploadSinkActive = true;
+}
+
+/////////////////////////////////////////////////
 
-  for (const auto& header : _headers)
+void AsyncWebServerRequest::setUploadSink(File file, AwsUploadSinkEnd onEnd)
+{
+  setUploadSink([file](uint8_t *data, size_t len) mutable -> size_t
+  {
+    size_t written = file.write(data, len);
+
+    return written ? written : UPLOAD_SINK_ERROR;
+  }, [file, onEnd](bool success, size_t size) mutable
   {
-    if (!_interestingHeaders.containsIgnoreCase(header->name().c_str()))
+    file.close();
+
+    if (onEnd)
+      onEnd(success, size);
+  });
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::_uploadPush(uint8_t *data, size_t len)
+{
+  while (len)
+  {
+    size_t n = _uploadSink->push(data, len);
+
+    data += n;
+    len -= n;
+
+    // Queue full, only if UPLOAD_SINK_BLOCKS doesn't cover the TCP window : write now
+    if (len && !_uploadSink->flush())
     {
-      _headers.remove(header);
+      AWS_LOGERROR1("_uploadPush: upload sink full, aborted at", _uploadSink->written());
+
+      _uploadSink->abort();
+
+      break;
     }
   }
 }
 
 /////////////////////////////////////////////////
 
+// Received data is acked to TCP once written, so a slow writer closes the TCP window instead of overflowing the sink.
+// received is the length of the buffer being handled by _onData(), AsyncClient can only ack it after _onData() returns.
+// Unacked bytes are the newest ones queued, pipelined data parsed again by _recycle() was acked when received
+void AsyncWebServerRequest::_uploadFlush(size_t received)
+{
+  _uploadSink->flush();
+
+  size_t held = _uploadSink->queued();
+  size_t keep = (held > received) ? held - received : 0;    // bytes of earlier buffers still queued
+
+  if (_uploadUnacked > keep)
+  {
+    _client->ack(_uploadUnacked - keep);
+    _uploadUnacked = keep;
+  }
+
+  if (held && received)
+  {
+    _client->ackLater();
+    _uploadUnacked += received;
+  }
+
+  if (_uploadRequestPending && _uploadSink->done())
+  {
+    _uploadRequestPending = false;
+    _handleRequest();
+  }
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::_removeNotInterestingHeaders()
+{
+  if (_interestingHeaders.containsIgnoreCase("ANY"))
+    return; // nothing to do
+
+  // Headers still in _rawHeaders are filtered when they are parsed, see _parseHeaders()
+  _headersFiltered = true;
+
+  _headers.remove_if([this](AsyncWebHeader * header)
+  {
+    return !_interestingHeaders.containsIgnoreCase(header->name().c_str());
+  });
+}
+
+/////////////////////////////////////////////////
+
 void AsyncWebServerRequest::_onPoll()
 {
+  // Retry a writer that was busy
+  if (_uploadSink && !_uploadSink->done())
+    _uploadFlush();
+
   if (_response != NULL && _client != NULL && _client->canSend() && !_response->_finished())
   {
+    // Read before _ack(), WebSocket and EventSource responses delete this request from there
+    const bool keepAlive = _response->_keepAlive();
+
     _response->_ack(this, 0, 0);
+    _checkKeepAlive(keepAlive);
   }
 
   // KH, Important for RP2040W, or system will hang
@@ -302,9 +472,13 @@ void AsyncWebServerRequest::_onAck(size_t len, uint32_t time)
 
   if (_response != NULL)
   {
+    // Read before _ack(), WebSocket and EventSource responses delete this request from there
+    const bool keepAlive = _response->_keepAlive();
+
     if (!_response->_finished())
     {
       _response->_ack(this, len, time);
+      _checkKeepAlive(keepAlive);
     }
     else
     {
@@ -320,6 +494,175 @@ void AsyncWebServerRequest::_onAck(size_t len, uint32_t time)
 
 /////////////////////////////////////////////////
 
+void AsyncWebServerRequest::_checkKeepAlive(bool keepAlive)
+{
+  // Must not touch this request unless the response was a keep-alive one
+  if (keepAlive && _keepAlive && _response && _response->_finished() && !_response->_failed())
+  {
+    _recycle();
+  }
+}
+
+/////////////////////////////////////////////////
+
+bool AsyncWebServerRequest::_bufferPipelined(const uint8_t *data, size_t len)
+{
+  if (_pipelineLength + len > KEEP_ALIVE_MAX_PIPELINED_LENGTH)
+    return false;
+
+  uint8_t *buf = (uint8_t*) realloc(_pipelineBuffer, _pipelineLength + len);
+
+  if (buf == NULL)
+    return false;
+
+  memcpy(buf + _pipelineLength, data, len);
+  _pipelineBuffer = buf;
+  _pipelineLength += len;
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::_recycle()
+{
+  // Response is finished on a persistent connection : reset the parse state for the next request
+  AWS_LOGDEBUG1("_recycle: requests served =", _requestCount + 1);
+
+  _server->_updateMemoryStats(_arena);
+
+  if (_uploadUnacked)
+    _client->ack(_uploadUnacked);
+
+  // The request ends here, not the connection : cleanup tied to onDisconnect() still runs, before _reset() drops it
+  if (_onDisconnectfn)
+    _onDisconnectfn();
+
+  _reset();
+  _requestCount++;
+
+  // Idle timeout until the next request arrives
+  _client->setRxTimeout(_server->keepAliveTimeout());
+
+  if (_pipelineBuffer != NULL)
+  {
+    // Parse the already received pipelined request(s)
+    uint8_t *buf = _pipelineBuffer;
+    size_t len   = _pipelineLength;
+
+    _pipelineBuffer = NULL;
+    _pipelineLength = 0;
+
+    // Acked when it was received, see _uploadFlush()
+    _parseData(buf, len, 0);
+    free(buf);
+  }
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::_detach()
+{
+  // Connection closed, back to the server's pool of requests
+  if ( (_parseState != PARSE_REQ_START) || !_requestCount )
+    _server->_updateMemoryStats(_arena);
+
+  _reset();
+
+  if (_pipelineBuffer != NULL)
+  {
+    free(_pipelineBuffer);
+    _pipelineBuffer = NULL;
+  }
+
+  _pipelineLength = 0;
+  _requestCount   = 0;
+  _client         = NULL;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::_reset()
+{
+  if (_response != NULL)
+  {
+    AsyncWebServerResponse* r = _response;
+    _response = NULL;
+    delete r;
+  }
+
+  _headers.free();
+  _rawHeaders = NULL;
+  _rawHeadersTail = NULL;
+  _headersFiltered = false;
+  _params.free();
+  _rawQuery.remove(0);
+  _pathParams.free();
+  _interestingHeaders.free();
+
+  // All of the above came from the arena
+  _arena.reset();
+
+  if (_tempObject != NULL)
+  {
+    free(_tempObject);
+    _tempObject = NULL;
+  }
+
+  if (_uploadSink != NULL)
+  {
+    delete _uploadSink;
+    _uploadSink = NULL;
+  }
+
+  _uploadUnacked        = 0;
+  _uploadSinkActive     = false;
+  _uploadRequestPending = false;
+
+  _tempFile           = File();
+  _handler            = NULL;
+  _onDisconnectfn     = nullptr;
+
+  // remove(0) keeps the String capacity for the next request, except for the body sized ones
+  _temp               = String();
+  _parseState         = PARSE_REQ_START;
+  _version            = 0;
+  _method             = HTTP_ANY;
+  _url.remove(0);
+  _host.remove(0);
+  _contentType.remove(0);
+  _boundary.remove(0);
+  _authorization.remove(0);
+  _reqconntype        = RCT_HTTP;
+
+  _isDigest           = false;
+  _isMultipart        = false;
+  _isPlainPost        = false;
+  _expectingContinue  = false;
+  _hasContentLength   = false;
+  _badRequest         = false;
+  _contentLength      = 0;
+  _parsedLength       = 0;
+
+  _keepAlive          = false;
+  _connectionClose    = false;
+  _connectionKeepAlive = false;
+  _transferEncoding   = false;
+  _emptyLines         = 0;
+
+  _multiParseState    = 0;
+  _boundaryPosition   = 0;
+  _itemStartIndex     = 0;
+  _itemSize           = 0;
+  _itemName.remove(0);
+  _itemFilename.remove(0);
+  _itemType.remove(0);
+  _itemValue          = String();
+  _itemIsFile         = false;
+}
+
+/////////////////////////////////////////////////
+
 void AsyncWebServerRequest::_onError(int8_t error)
 {
   RP2040W_AWS_UNUSED(error);
@@ -365,6 +708,8 @@ void AsyncWebServerRequest::_onDisconnect()
 
 void AsyncWebServerRequest::_addParam(AsyncWebParameter *p)
 {
+  // Query params come first
+  _parseParams();
   _params.add(p);
 }
 
@@ -372,122 +717,181 @@ void AsyncWebServerRequest::_addParam(AsyncWebParameter *p)
 
 void AsyncWebServerRequest::_addPathParam(const char *p)
 {
-  _pathParams.add(new String(p));
+  _pathParams.add(_arena.create<String>(p));
 }
 
 /////////////////////////////////////////////////
 
-void AsyncWebServerRequest::_addGetParams(const String& params)
+void AsyncWebServerRequest::_addGetParams(const char *params, size_t len)
 {
-  size_t start = 0;
+  if (!len)
+    return;
 
-  while (start < params.length())
-  {
-    int end = params.indexOf('&', start);
+  // Split and decoded on first access to the params, see _parseParams()
+  if (_rawQuery.length())
+    _rawQuery.concat('&');
+
+  _rawQuery.concat(params, len);
+}
 
-    if (end < 0)
-      end = params.length();
+/////////////////////////////////////////////////
 
-    int equal = params.indexOf('=', start);
+// Decode %XX and '+' over str, return the decoded length
+static size_t _urlDecodeInPlace(char *str, size_t len)
+{
+  size_t out = 0;
 
-    if (equal < 0 || equal > end)
-      equal = end;
+  for (size_t i = 0; i < len; i++)
+  {
+    char c = str[i];
+
+    if ((c == '%') && (i + 2 < len) && isxdigit((uint8_t) str[i + 1]) && isxdigit((uint8_t) str[i + 2]))
+    {
+      char hex[3] = { str[i + 1], str[i + 2], 0 };
 
-    String name = params.substring(start, equal);
-    String value = equal + 1 < end ? params.substring(equal + 1, end) : String();
-    _addParam(new AsyncWebParameter(urlDecode(name), urlDecode(value)));
-    start = end + 1;
+      c = (char) strtol(hex, NULL, 16);
+      i += 2;
+    }
+    else if (c == '+')
+    {
+      c = ' ';
+    }
+
+    str[out++] = c;
   }
+
+  return out;
 }
 
 /////////////////////////////////////////////////
 
-bool AsyncWebServerRequest::_parseReqHead()
+void AsyncWebServerRequest::_parseParams() const
 {
-  // Split the head into method, url and version
-  int index = _temp.indexOf(' ');
-  String m  = _temp.substring(0, index);
-  index     = _temp.indexOf(' ', index + 1);
-  String u  = _temp.substring(m.length() + 1, index);
-  _temp     = _temp.substring(index + 1);
+  if (!_rawQuery.length())
+    return;
 
-  if (m == "GET")
-  {
-    _method = HTTP_GET;
-  }
-  else if (m == "POST")
-  {
-    _method = HTTP_POST;
-  }
-  else if (m == "DELETE")
-  {
-    _method = HTTP_DELETE;
-  }
-  else if (m == "PUT")
-  {
-    _method = HTTP_PUT;
-  }
-  else if (m == "PATCH")
-  {
-    _method = HTTP_PATCH;
-  }
-  else if (m == "HEAD")
-  {
-    _method = HTTP_HEAD;
-  }
-  else if (m == "OPTIONS")
+  char *str = _rawQuery.begin();
+  char *end = str + _rawQuery.length();
+
+  while (str < end)
   {
-    _method = HTTP_OPTIONS;
+    char *amp = (char *) memchr(str, '&', end - str);
+
+    if (amp == NULL)
+      amp = end;
+
+    char *equal = (char *) memchr(str, '=', amp - str);
+    char *value = equal ? equal + 1 : amp;
+
+    String name;
+    String val;
+
+    name.concat(str, _urlDecodeInPlace(str, (equal ? equal : amp) - str));
+    val.concat(value, _urlDecodeInPlace(value, amp - value));
+
+    _params.add(_arena.create<AsyncWebParameter>(name, val));
+    str = amp + 1;
   }
 
-  String g = String();
-  index = u.indexOf('?');
+  // remove(0) keeps the capacity for the next request on the connection
+  _rawQuery.remove(0);
+}
+
+/////////////////////////////////////////////////
+
+bool AsyncWebServerRequest::_parseReqHead(const char *line, size_t len)
+{
+  // Split the head into method, url and version
+  const char *end = line + len;
+  const char *sp  = (const char*) memchr(line, ' ', len);
+
+  if (sp == NULL)
+    return false;
 
-  if (index > 0)
+  const size_t mlen = sp - line;
+
+  // Dispatch on length first, then compare
+  switch (mlen)
   {
-    g = u.substring(index + 1);
-    u = u.substring(0, index);
+    case 3:
+      if (!memcmp(line, "GET", 3))
+        _method = HTTP_GET;
+      else if (!memcmp(line, "PUT", 3))
+        _method = HTTP_PUT;
+
+      break;
+
+    case 4:
+      if (!memcmp(line, "POST", 4))
+        _method = HTTP_POST;
+      else if (!memcmp(line, "HEAD", 4))
+        _method = HTTP_HEAD;
+
+      break;
+
+    case 5:
+      if (!memcmp(line, "PATCH", 5))
+        _method = HTTP_PATCH;
+
+      break;
+
+    case 6:
+      if (!memcmp(line, "DELETE", 6))
+        _method = HTTP_DELETE;
+
+      break;
+
+    case 7:
+      if (!memcmp(line, "OPTIONS", 7))
+        _method = HTTP_OPTIONS;
+
+      break;
+
+    default:
+      break;
   }
 
-  _url = urlDecode(u);
-  _addGetParams(g);
+  const char *u     = sp + 1;
+  const char *uEnd  = (const char*) memchr(u, ' ', end - u);
 
-  if (!_temp.startsWith("HTTP/1.0"))
-    _version = 1;
+  if (uEnd == NULL)
+    uEnd = end;
+
+  const char *query = (const char*) memchr(u, '?', uEnd - u);
+
+  if (query == u)
+    query = NULL;
+
+  _url.remove(0);
+  _url.concat(u, (query ? query : uEnd) - u);
+
+  size_t urlLength = _urlDecodeInPlace(_url.begin(), _url.length());
+
+  if (urlLength < _url.length())
+    _url.remove(urlLength);
 
-  _temp = String();
+  if (query)
+    _addGetParams(query + 1, uEnd - query - 1);
+
+  const char *ver = (uEnd < end) ? uEnd + 1 : end;
+
+  if ( (end - ver < 8) || memcmp(ver, "HTTP/1.0", 8) )
+    _version = 1;
 
   return true;
 }
 
 /////////////////////////////////////////////////
 
-bool strContains(String src, String find, bool mindcase = true)
+// Case insensitive search of find in the len chars at src
+static bool strContains(const char *src, size_t len, const char *find)
 {
-  int pos = 0, i = 0;
-  const int slen = src.length();
-  const int flen = find.length();
-
-  if (slen < flen)
-    return false;
+  const size_t flen = strlen(find);
 
-  while (pos <= (slen - flen))
+  for (size_t pos = 0; pos + flen <= len; pos++)
   {
-    for (i = 0; i < flen; i++)
-    {
-      if (mindcase)
-      {
-        if (src[pos + i] != find[i])
-          i = flen + 1; // no match
-      }
-      else if (tolower(src[pos + i]) != tolower(find[i]))
-        i = flen + 1; // no match
-    }
-
-    if (i == flen)
+    if (!strncasecmp(src + pos, find, flen))
       return true;
-
-    pos++;
   }
 
   return false;
@@ -495,77 +899,211 @@ bool strContains(String src, String find, bool mindcase = true)
 
 /////////////////////////////////////////////////
 
-bool AsyncWebServerRequest::_parseReqHeader()
+static inline bool nameIs(const char *name, size_t len, const char *known, size_t knownLen)
 {
-  int index = _temp.indexOf(':');
+  return (len == knownLen) && !strncasecmp(name, known, len);
+}
 
-  if (index)
-  {
-    String name = _temp.substring(0, index);
-    String value = _temp.substring(index + 2);
+/////////////////////////////////////////////////
 
-    if (name.equalsIgnoreCase("Host"))
-    {
-      _host = value;
-    }
-    else if (name.equalsIgnoreCase("Content-Type"))
-    {
-      _contentType = value.substring(0, value.indexOf(';'));
+bool AsyncWebServerRequest::_parseReqHeader(const char *line, size_t len)
+{
+  const char *colon = (const char*) memchr(line, ':', len);
+
+  if (colon == NULL)
+    return false;
 
-      if (value.startsWith("multipart/"))
+  const char *name    = line;
+  const size_t nlen   = colon - line;
+  const char *value   = colon + 1;
+  const char *end     = line + len;
+
+  while (value < end && (*value == ' ' || *value == '\t'))
+    value++;
+
+  const size_t vlen = end - value;
+
+  // Headers the request needs itself, dispatched on length and first char
+  switch (nlen)
+  {
+    case 4:
+      if (nameIs(name, nlen, "Host", 4))
       {
-        _boundary = value.substring(value.indexOf('=') + 1);
-        _boundary.replace("\"", "");
-        _isMultipart = true;
+        _host = String();
+        _host.concat(value, vlen);
       }
-    }
-    else if (name.equalsIgnoreCase("Content-Length"))
-    {
-      _contentLength = atoi(value.c_str());
-    }
-    else if (name.equalsIgnoreCase("Expect") && value == "100-continue")
-    {
-      _expectingContinue = true;
-    }
-    else if (name.equalsIgnoreCase("Authorization"))
-    {
-      if (value.length() > 5 && value.substring(0, 5).equalsIgnoreCase("Basic"))
+
+      break;
+
+    case 6:
+      if (nameIs(name, nlen, "Expect", 6))
       {
-        _authorization = value.substring(6);
+        if ( (vlen == 12) && !memcmp(value, "100-continue", 12) )
+          _expectingContinue = true;
       }
-      else if (value.length() > 6 && value.substring(0, 6).equalsIgnoreCase("Digest"))
+      else if (nameIs(name, nlen, "Accept", 6) && strContains(value, vlen, "text/event-stream"))
       {
-        _isDigest = true;
-        _authorization = value.substring(7);
+        // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
+        if (_reqconntype != RCT_WS)
+          _reqconntype = RCT_EVENT;
       }
-    }
-    else
-    {
-      if (name.equalsIgnoreCase("Upgrade") && value.equalsIgnoreCase("websocket"))
+
+      break;
+
+    case 7:
+      if (nameIs(name, nlen, "Upgrade", 7) && nameIs(value, vlen, "websocket", 9))
       {
         // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
         _reqconntype = RCT_WS;
       }
-      else
+
+      break;
+
+    case 10:
+      if (nameIs(name, nlen, "Connection", 10))
+      {
+        _connectionClose      = strContains(value, vlen, "close");
+        _connectionKeepAlive  = strContains(value, vlen, "keep-alive");
+      }
+
+      break;
+
+    case 12:
+      if (nameIs(name, nlen, "Content-Type", 12))
+      {
+        const char *semicolon = (const char*) memchr(value, ';', vlen);
+
+        _contentType = String();
+        _contentType.concat(value, (semicolon ? semicolon : end) - value);
+
+        if ( (vlen >= 10) && !memcmp(value, "multipart/", 10) )
+        {
+          const char *equal = (const char*) memchr(value, '=', vlen);
+
+          _boundary = String();
+
+          if (equal)
+            _boundary.concat(equal + 1, end - equal - 1);
+
+          _boundary.replace("\"", "");
+          _isMultipart = true;
+        }
+      }
+
+      break;
+
+    case 13:
+      if (nameIs(name, nlen, "Authorization", 13))
+      {
+        if (vlen > 5 && !strncasecmp(value, "Basic", 5))
+        {
+          _authorization = String();
+          _authorization.concat(value + 6, vlen - 6);
+        }
+        else if (vlen > 6 && !strncasecmp(value, "Digest", 6))
+        {
+          _isDigest = true;
+          _authorization = String();
+          _authorization.concat(value + 7, vlen - 7);
+        }
+      }
+
+      break;
+
+    case 14:
+      if (nameIs(name, nlen, "Content-Length", 14))
       {
-        if (name.equalsIgnoreCase("Accept") && strContains(value, "text/event-stream", false))
+        // A wrong body length desyncs the requests that follow on a persistent connection : digits only,
+        // no overflow, and the same value if repeated
+        size_t length = 0;
+        size_t i      = 0;
+
+        for (; i < vlen && isdigit(value[i]); i++)
+        {
+          const size_t digit = value[i] - '0';
+
+          if (length > (SIZE_MAX - digit) / 10)
+            break;
+
+          length = length * 10 + digit;
+        }
+
+        if (!vlen || (i < vlen) || (_hasContentLength && (length != _contentLength)))
         {
-          // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
-          _reqconntype = RCT_EVENT;
+          AWS_LOGDEBUG("_parseReqHeader: invalid Content-Length");
+
+          _badRequest = true;
         }
+
+        _hasContentLength = true;
+        _contentLength    = length;
       }
-    }
 
-    _headers.add(new AsyncWebHeader(name, value));
+      break;
+
+    case 17:
+      if (nameIs(name, nlen, "Transfer-Encoding", 17))
+      {
+        // Only Content-Length bodies are parsed, a chunked body would be read as the next request
+        _transferEncoding = true;
+      }
+
+      break;
+
+    default:
+      break;
+  }
+
+  // Keep a copy in the arena, AsyncWebHeader objects are only built if the headers are read
+  RawHeader *raw = (RawHeader*) _arena.allocate(sizeof(RawHeader));
+
+  if (raw)
+  {
+    raw->next   = NULL;
+    raw->name   = _arena.strdup(name, nlen);
+    raw->value  = raw->name ? _arena.strdup(value, vlen) : NULL;
+  }
+
+  if (raw && raw->value)
+  {
+    if (_rawHeadersTail)
+      _rawHeadersTail->next = raw;
+    else
+      _rawHeaders = raw;
+
+    _rawHeadersTail = raw;
   }
+  else
+  {
+    // No arena
+    String n, v;
 
-  _temp = String();
+    n.concat(name, nlen);
+    v.concat(value, vlen);
+    _headers.add(new AsyncWebHeader(n, v));
+  }
 
   return true;
 }
 
 /////////////////////////////////////////////////
 
+void AsyncWebServerRequest::_parseHeaders() const
+{
+  const bool filter = _headersFiltered && !_interestingHeaders.containsIgnoreCase("ANY");
+
+  for (RawHeader *raw = _rawHeaders; raw; raw = raw->next)
+  {
+    if (!filter || _interestingHeaders.containsIgnoreCase(raw->name))
+      _headers.add(_arena.create<AsyncWebHeader>(raw->name, raw->value));
+  }
+
+  _rawHeaders = NULL;
+  _rawHeadersTail = NULL;
+}
+
+/////////////////////////////////////////////////
+
 void AsyncWebServerRequest::_parsePlainPostChar(uint8_t data)
 {
   if (data && (char)data != '&')
@@ -582,24 +1120,104 @@ void AsyncWebServerRequest::_parsePlainPostChar(uint8_t data)
       value = _temp.substring(_temp.indexOf('=') + 1);
     }
 
-    _addParam(new AsyncWebParameter(urlDecode(name), urlDecode(value), true));
+    _addParam(_arena.create<AsyncWebParameter>(urlDecode(name), urlDecode(value), true));
     _temp = String();
   }
 }
 
 /////////////////////////////////////////////////
 
-void AsyncWebServerRequest::_handleUploadByte(uint8_t data, bool last)
+// File data is handed to the upload handler as slices of the received buffer, values are appended to _itemValue
+void AsyncWebServerRequest::_itemWrite(uint8_t *data, size_t len, bool final)
+{
+  if (_itemIsFile)
+  {
+    if (_uploadSinkActive)
+    {
+      _uploadPush(data, len);
+    }
+    else if ((len || (final && _itemSize)) && _handler)
+    {
+      // Empty files are not reported
+      //check if authenticated before calling the upload
+      _handler->handleUpload(this, _itemFilename, _itemSize, data, len, final);
+
+      // The handler has just set an upload sink, this data is the first it gets
+      if (_uploadSinkActive)
+        _uploadPush(data, len);
+    }
+
+    if (final && _uploadSinkActive)
+    {
+      _uploadSink->finish();
+      _uploadSinkActive = false;
+    }
+  }
+  else
+  {
+    _itemValue.concat((const char*) data, len);
+  }
+
+  _itemSize += len;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::_itemEnd()
 {
-  _itemBuffer[_itemBufferIndex++] = data;
+  if (!_itemIsFile)
+  {
+    _addParam(_arena.create<AsyncWebParameter>(_itemName, _itemValue, true));
+  }
+  else if (_itemSize)
+  {
+    _addParam(_arena.create<AsyncWebParameter>(_itemName, _itemFilename, true, true, _itemSize));
+  }
+}
+
+/////////////////////////////////////////////////
 
-  if (last || _itemBufferIndex == 1460)
+void AsyncWebServerRequest::_parseMultipartHeader()
+{
+  if (_temp.length() > 12 && _temp.substring(0, 12).equalsIgnoreCase("Content-Type"))
+  {
+    _itemType = _temp.substring(14);
+    _itemIsFile = true;
+  }
+  else if (_temp.length() > 19 && _temp.substring(0, 19).equalsIgnoreCase("Content-Disposition"))
   {
-    //check if authenticated before calling the upload
-    if (_handler)
-      _handler->handleUpload(this, _itemFilename, _itemSize - _itemBufferIndex, _itemBuffer, _itemBufferIndex, false);
+    _temp = _temp.substring(_temp.indexOf(';') + 2);
+
+    while (_temp.indexOf(';') > 0)
+    {
+      String name = _temp.substring(0, _temp.indexOf('='));
+      String nameVal = _temp.substring(_temp.indexOf('=') + 2, _temp.indexOf(';') - 1);
+
+      if (name == "name")
+      {
+        _itemName = nameVal;
+      }
+      else if (name == "filename")
+      {
+        _itemFilename = nameVal;
+        _itemIsFile = true;
+      }
+
+      _temp = _temp.substring(_temp.indexOf(';') + 2);
+    }
+
+    String name = _temp.substring(0, _temp.indexOf('='));
+    String nameVal = _temp.substring(_temp.indexOf('=') + 2, _temp.length() - 1);
 
-    _itemBufferIndex = 0;
+    if (name == "name")
+    {
+      _itemName = nameVal;
+    }
+    else if (name == "filename")
+    {
+      _itemFilename = nameVal;
+      _itemIsFile = true;
+    }
   }
 }
 
@@ -609,11 +1227,7 @@ enum
 {
   EXPECT_BOUNDARY,
   PARSE_HEADERS,
-  WAIT_FOR_RETURN1,
-  EXPECT_FEED1,
-  EXPECT_DASH1,
-  EXPECT_DASH2,
-  BOUNDARY_OR_DATA,
+  PARSE_DATA,
   DASH3_OR_RETURN2,
   EXPECT_FEED2,
   PARSING_FINISHED,
@@ -622,10 +1236,11 @@ enum
 
 /////////////////////////////////////////////////
 
-void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last)
+// Parts end with the delimiter "\r\n--" + boundary. Data is scanned a block at a time with memchr() for the '\r',
+// and a delimiter split across two received buffers is tracked in _boundaryPosition.
+// The boundary can't contain '\r', so a partial match never overlaps the start of another one.
+void AsyncWebServerRequest::_parseMultipartPost(uint8_t *data, size_t len)
 {
-#define itemWriteByte(b)        do { _itemSize++; if(_itemIsFile) _handleUploadByte(b, last); else _itemValue+=(char)(b); } while(0)
-
   if (!_parsedLength)
   {
     _multiParseState = EXPECT_BOUNDARY;
@@ -635,298 +1250,230 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last)
     _itemType = String();
   }
 
-  if (_multiParseState == WAIT_FOR_RETURN1)
-  {
-    if (data != '\r')
-    {
-      itemWriteByte(data);
-    }
-    else
-    {
-      _multiParseState = EXPECT_FEED1;
-    }
-  }
-  else if (_multiParseState == EXPECT_BOUNDARY)
-  {
-    if (_parsedLength < 2 && data != '-')
-    {
-      _multiParseState = PARSE_ERROR;
+  const char * boundary = _boundary.c_str();
+  const size_t delimiterLen = _boundary.length() + 4;
+  uint8_t *end = data + len;
 
-      return;
-    }
-    else if (_parsedLength - 2 < _boundary.length() && _boundary.c_str()[_parsedLength - 2] != data)
-    {
-      _multiParseState = PARSE_ERROR;
+#define delimiterByte(i)        ((i) < 4 ? "\r\n--"[i] : boundary[(i) - 4])
 
-      return;
-    }
-    else if (_parsedLength - 2 == _boundary.length() && data != '\r')
+  while (data < end)
+  {
+    if (_multiParseState == EXPECT_BOUNDARY)
     {
-      _multiParseState = PARSE_ERROR;
+      size_t pos = _parsedLength;
+      uint8_t c = *data;
 
-      return;
-    }
-    else if (_parsedLength - 3 == _boundary.length())
-    {
-      if (data != '\n')
+      if ( (pos < 2 && c != '-') || (pos >= 2 && pos - 2 < _boundary.length() && boundary[pos - 2] != c)
+           || (pos - 2 == _boundary.length() && c != '\r') || (pos - 3 == _boundary.length() && c != '\n') )
       {
         _multiParseState = PARSE_ERROR;
-
-        return;
+      }
+      else if (pos - 3 == _boundary.length())
+      {
+        _multiParseState = PARSE_HEADERS;
+        _itemIsFile = false;
       }
 
-      _multiParseState = PARSE_HEADERS;
-      _itemIsFile = false;
+      data++;
+      _parsedLength++;
     }
-  }
-  else if (_multiParseState == PARSE_HEADERS)
-  {
-    if ((char)data != '\r' && (char)data != '\n')
-      _temp += (char)data;
-
-    if ((char)data == '\n')
+    else if (_multiParseState == PARSE_HEADERS)
     {
-      if (_temp.length())
-      {
-        if (_temp.length() > 12 && _temp.substring(0, 12).equalsIgnoreCase("Content-Type"))
-        {
-          _itemType = _temp.substring(14);
-          _itemIsFile = true;
-        }
-        else if (_temp.length() > 19 && _temp.substring(0, 19).equalsIgnoreCase("Content-Disposition"))
-        {
-          _temp = _temp.substring(_temp.indexOf(';') + 2);
-
-          while (_temp.indexOf(';') > 0)
-          {
-            String name = _temp.substring(0, _temp.indexOf('='));
-            String nameVal = _temp.substring(_temp.indexOf('=') + 2, _temp.indexOf(';') - 1);
+      uint8_t *eol = (uint8_t *) memchr(data, '\n', end - data);
+      uint8_t *stop = eol ? eol : end;
 
-            if (name == "name")
-            {
-              _itemName = nameVal;
-            }
-            else if (name == "filename")
-            {
-              _itemFilename = nameVal;
-              _itemIsFile = true;
-            }
+      _temp.concat((const char*) data, stop - data);
+      _parsedLength += stop - data;
+      data = stop;
 
-            _temp = _temp.substring(_temp.indexOf(';') + 2);
-          }
+      if (!eol)
+        break;
 
-          String name = _temp.substring(0, _temp.indexOf('='));
-          String nameVal = _temp.substring(_temp.indexOf('=') + 2, _temp.length() - 1);
+      data++;
+      _parsedLength++;
 
-          if (name == "name")
-          {
-            _itemName = nameVal;
-          }
-          else if (name == "filename")
-          {
-            _itemFilename = nameVal;
-            _itemIsFile = true;
-          }
-        }
+      if (_temp.length() && _temp.c_str()[_temp.length() - 1] == '\r')
+        _temp.remove(_temp.length() - 1);
 
+      if (_temp.length())
+      {
+        _parseMultipartHeader();
         _temp = String();
       }
       else
       {
-        _multiParseState = WAIT_FOR_RETURN1;
-
         //value starts from here
+        _multiParseState = PARSE_DATA;
+        _boundaryPosition = 0;
         _itemSize = 0;
         _itemStartIndex = _parsedLength;
         _itemValue = String();
+      }
+    }
+    else if (_multiParseState == PARSE_DATA)
+    {
+      if (_boundaryPosition)
+      {
+        // Continue the delimiter started at the end of the last buffer
+        while (data < end && _boundaryPosition < delimiterLen && *data == delimiterByte(_boundaryPosition))
+        {
+          data++;
+          _parsedLength++;
+          _boundaryPosition++;
+        }
 
-        if (_itemIsFile)
+        if (_boundaryPosition == delimiterLen)
         {
-          if (_itemBuffer)
-            free(_itemBuffer);
+          _itemWrite(data, 0, true);
+          _itemEnd();
+          _multiParseState = DASH3_OR_RETURN2;
 
-          _itemBuffer = (uint8_t*) malloc(1460);
+          continue;
+        }
 
-          if (_itemBuffer == NULL)
-          {
-            _multiParseState = PARSE_ERROR;
+        if (data == end)
+          break;
 
-            return;
-          }
+        // Not a delimiter after all, the bytes held back were data : "\r\n--" then the start of the boundary
+        _itemWrite((uint8_t *) "\r\n--", std::min(_boundaryPosition, (size_t) 4), false);
 
-          _itemBufferIndex = 0;
-        }
+        if (_boundaryPosition > 4)
+          _itemWrite((uint8_t *) boundary, _boundaryPosition - 4, false);
+
+        _boundaryPosition = 0;
       }
-    }
-  }
-  else if (_multiParseState == EXPECT_FEED1)
-  {
-    if (data != '\n')
-    {
-      _multiParseState = WAIT_FOR_RETURN1;
-      itemWriteByte('\r');
 
-      _parseMultipartPostByte(data, last);
-    }
-    else
-    {
-      _multiParseState = EXPECT_DASH1;
-    }
-  }
-  else if (_multiParseState == EXPECT_DASH1)
-  {
-    if (data != '-')
-    {
-      _multiParseState = WAIT_FOR_RETURN1;
-      itemWriteByte('\r');
-      itemWriteByte('\n');
+      uint8_t *scan = data;
 
-      _parseMultipartPostByte(data, last);
-    }
-    else
-    {
-      _multiParseState = EXPECT_DASH2;
-    }
-  }
-  else if (_multiParseState == EXPECT_DASH2)
-  {
-    if (data != '-')
-    {
-      _multiParseState = WAIT_FOR_RETURN1;
-      itemWriteByte('\r');
-      itemWriteByte('\n');
-      itemWriteByte('-');
+      while (true)
+      {
+        uint8_t *cr = (uint8_t *) memchr(scan, '\r', end - scan);
 
-      _parseMultipartPostByte(data, last);
-    }
-    else
-    {
-      _multiParseState = BOUNDARY_OR_DATA;
-      _boundaryPosition = 0;
-    }
-  }
-  else if (_multiParseState == BOUNDARY_OR_DATA)
-  {
-    if (_boundaryPosition < _boundary.length() && _boundary.c_str()[_boundaryPosition] != data)
-    {
-      _multiParseState = WAIT_FOR_RETURN1;
-      itemWriteByte('\r');
-      itemWriteByte('\n');
-      itemWriteByte('-');
-      itemWriteByte('-');
+        if (!cr)
+        {
+          _itemWrite(data, end - data, false);
+          _parsedLength += end - data;
+          data = end;
+
+          break;
+        }
 
-      uint8_t i;
+        size_t avail = end - cr;
+        size_t matched = 0;
 
-      for (i = 0; i < _boundaryPosition; i++)
-        itemWriteByte(_boundary.c_str()[i]);
+        while (matched < delimiterLen && matched < avail && cr[matched] == delimiterByte(matched))
+          matched++;
 
-      _parseMultipartPostByte(data, last);
+        if (matched == delimiterLen)
+        {
+          _itemWrite(data, cr - data, true);
+          _itemEnd();
+          _multiParseState = DASH3_OR_RETURN2;
+          _parsedLength += cr + delimiterLen - data;
+          data = cr + delimiterLen;
+
+          break;
+        }
+
+        if (matched == avail)
+        {
+          // Possible delimiter cut by the end of the buffer, hold it back until the next one
+          _itemWrite(data, cr - data, false);
+          _boundaryPosition = matched;
+          _parsedLength += end - data;
+          data = end;
+
+          break;
+        }
+
+        scan = cr + 1;
+      }
     }
-    else if (_boundaryPosition == _boundary.length() - 1)
+    else if (_multiParseState == DASH3_OR_RETURN2)
     {
-      _multiParseState = DASH3_OR_RETURN2;
+      if (*data == '-' && (_contentLength - _parsedLength - 4) != 0)
+      {
+        AWS_LOGDEBUG1("ERROR: The parser at the end of the POST but expecting more bytes =",
+                      (_contentLength - _parsedLength - 4));
 
-      if (!_itemIsFile)
+        _contentLength = _parsedLength + 4;//lets close the request gracefully
+      }
+
+      if (*data == '\r')
+      {
+        _multiParseState = EXPECT_FEED2;
+      }
+      else if (*data == '-' && _contentLength == (_parsedLength + 4))
       {
-        _addParam(new AsyncWebParameter(_itemName, _itemValue, true));
+        _multiParseState = PARSING_FINISHED;
       }
       else
       {
-        if (_itemSize)
-        {
-          //check if authenticated before calling the upload
-          if (_handler)
-            _handler->handleUpload(this, _itemFilename, _itemSize - _itemBufferIndex, _itemBuffer, _itemBufferIndex, true);
-
-          _itemBufferIndex = 0;
-          _addParam(new AsyncWebParameter(_itemName, _itemFilename, true, true, _itemSize));
-        }
+        AWS_LOGDEBUG1("ERROR: Unexpected byte after multipart boundary =", *data);
 
-        free(_itemBuffer);
-        _itemBuffer = NULL;
+        _multiParseState = PARSE_ERROR;
       }
 
+      data++;
+      _parsedLength++;
     }
-    else
-    {
-      _boundaryPosition++;
-    }
-  }
-  else if (_multiParseState == DASH3_OR_RETURN2)
-  {
-    if (data == '-' && (_contentLength - _parsedLength - 4) != 0)
+    else if (_multiParseState == EXPECT_FEED2)
     {
-      AWS_LOGDEBUG1("ERROR: The parser at the end of the POST but expecting more bytes =",
-                    (_contentLength - _parsedLength - 4));
+      if (*data == '\n')
+      {
+        _multiParseState = PARSE_HEADERS;
+        _itemIsFile = false;
+      }
+      else
+      {
+        AWS_LOGDEBUG1("ERROR: Unexpected byte after multipart boundary =", *data);
 
-      _contentLength = _parsedLength + 4;//lets close the request gracefully
-    }
+        _multiParseState = PARSE_ERROR;
+      }
 
-    if (data == '\r')
-    {
-      _multiParseState = EXPECT_FEED2;
-    }
-    else if (data == '-' && _contentLength == (_parsedLength + 4))
-    {
-      _multiParseState = PARSING_FINISHED;
+      data++;
+      _parsedLength++;
     }
     else
     {
-      _multiParseState = WAIT_FOR_RETURN1;
-      itemWriteByte('\r');
-      itemWriteByte('\n');
-      itemWriteByte('-');
-      itemWriteByte('-');
-
-      uint8_t i;
-
-      for (i = 0; i < _boundary.length(); i++)
-        itemWriteByte(_boundary.c_str()[i]);
-
-      _parseMultipartPostByte(data, last);
+      // PARSING_FINISHED or PARSE_ERROR, the rest of the body is ignored
+      _parsedLength += end - data;
+      data = end;
     }
   }
-  else if (_multiParseState == EXPECT_FEED2)
-  {
-    if (data == '\n')
-    {
-      _multiParseState = PARSE_HEADERS;
-      _itemIsFile = false;
-    }
-    else
-    {
-      _multiParseState = WAIT_FOR_RETURN1;
-      itemWriteByte('\r');
-      itemWriteByte('\n');
-      itemWriteByte('-');
-      itemWriteByte('-');
 
-      uint8_t i;
-
-      for (i = 0; i < _boundary.length(); i++)
-        itemWriteByte(_boundary.c_str()[i]);
-
-      itemWriteByte('\r');
-
-      _parseMultipartPostByte(data, last);
-    }
-  }
+#undef delimiterByte
 }
 
 /////////////////////////////////////////////////
 
-void AsyncWebServerRequest::_parseLine()
+void AsyncWebServerRequest::_parseLine(const char *line, size_t len)
 {
+  // trim
+  while (len && isspace(*line))
+  {
+    line++;
+    len--;
+  }
+
+  while (len && isspace(line[len - 1]))
+    len--;
+
   if (_parseState == PARSE_REQ_START)
   {
-    if (!_temp.length())
+    if (!len && _requestCount && (_emptyLines < KEEP_ALIVE_MAX_EMPTY_LINES))
+    {
+      // Extra CRLF some clients send after the previous request's body
+      _emptyLines++;
+    }
+    else if (!len)
     {
       _parseState = PARSE_REQ_FAIL;
       _client->close();
     }
     else
     {
-      _parseReqHead();
+      _parseReqHead(line, len);
       _parseState = PARSE_REQ_HEADERS;
     }
 
@@ -935,11 +1482,27 @@ void AsyncWebServerRequest::_parseLine()
 
   if (_parseState == PARSE_REQ_HEADERS)
   {
-    if (!_temp.length())
+    if (!len)
     {
       //end of headers
+      if (_badRequest)
+      {
+        // Where the body ends is unknown, so is the next request : answer and close
+        _parseState = PARSE_REQ_END;
+        send(400);
+
+        return;
+      }
+
       _server->_rewriteRequest(this);
       _server->_attachHandler(this);
+
+      // HTTP/1.1 is persistent unless "Connection: close", HTTP/1.0 only with "Connection: keep-alive".
+      // HEAD responses still carry a body here, so don't reuse their connection, nor one whose body isn't
+      // delimited by Content-Length
+      _keepAlive = _server->keepAlive() && (_reqconntype == RCT_HTTP) && (_method != HTTP_HEAD) && !_transferEncoding
+                   && (_version ? !_connectionClose : _connectionKeepAlive)
+                   && (!_server->keepAliveMaxRequests() || (_requestCount + 1U < _server->keepAliveMaxRequests()));
       
       _removeNotInterestingHeaders();    // KH, Crashing WS if used
 
@@ -970,7 +1533,7 @@ void AsyncWebServerRequest::_parseLine()
       }
     }
     else
-      _parseReqHeader();
+      _parseReqHeader(line, len);
   }
 }
 
@@ -978,6 +1541,8 @@ void AsyncWebServerRequest::_parseLine()
 
 size_t AsyncWebServerRequest::headers() const
 {
+  _parseHeaders();
+
   return _headers.length();
 }
 
@@ -985,6 +1550,8 @@ size_t AsyncWebServerRequest::headers() const
 
 bool AsyncWebServerRequest::hasHeader(const String& name) const
 {
+  _parseHeaders();
+
   for (const auto& h : _headers)
   {
     if (h->name().equalsIgnoreCase(name))
@@ -1000,6 +1567,8 @@ bool AsyncWebServerRequest::hasHeader(const String& name) const
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(const String& name) const
 {
+  _parseHeaders();
+
   for (const auto& h : _headers)
   {
     if (h->name().equalsIgnoreCase(name))
@@ -1015,6 +1584,8 @@ AsyncWebHeader* AsyncWebServerRequest::getHeader(const String& name) const
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(size_t num) const
 {
+  _parseHeaders();
+
   auto header = _headers.nth(num);
 
   return (header ? *header : nullptr);
@@ -1024,6 +1595,8 @@ AsyncWebHeader* AsyncWebServerRequest::getHeader(size_t num) const
 
 size_t AsyncWebServerRequest::params() const
 {
+  _parseParams();
+
   return _params.length();
 }
 
@@ -1031,6 +1604,8 @@ size_t AsyncWebServerRequest::params() const
 
 bool AsyncWebServerRequest::hasParam(const String& name, bool post, bool file) const
 {
+  _parseParams();
+
   for (const auto& p : _params)
   {
     if (p->name() == name && p->isPost() == post && p->isFile() == file)
@@ -1046,6 +1621,8 @@ bool AsyncWebServerRequest::hasParam(const String& name, bool post, bool file) c
 
 AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post, bool file) const
 {
+  _parseParams();
+
   for (const auto& p : _params)
   {
     if (p->name() == name && p->isPost() == post && p->isFile() == file)
@@ -1061,6 +1638,8 @@ AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post
 
 AsyncWebParameter* AsyncWebServerRequest::getParam(size_t num) const
 {
+  _parseParams();
+
   auto param = _params.nth(num);
 
   return (param ? *param : nullptr);
@@ -1156,6 +1735,14 @@ AsyncWebServerResponse * AsyncWebServerRequest::beginResponse(Stream &stream, co
 
 /////////////////////////////////////////////////
 
+AsyncWebServerResponse * AsyncWebServerRequest::beginResponse(AsyncBlockStream &stream, const String& contentType,
+                                                              size_t len, AwsTemplateProcessor callback)
+{
+  return new AsyncStreamResponse(stream, contentType, len, callback);
+}
+
+/////////////////////////////////////////////////
+
 AsyncWebServerResponse * AsyncWebServerRequest::beginResponse(const String& contentType, size_t len,
                                                               AwsResponseFiller callback,
                                                               AwsTemplateProcessor templateCallback)
@@ -1255,6 +1842,14 @@ void AsyncWebServerRequest::send(Stream &stream, const String& contentType, size
 
 /////////////////////////////////////////////////
 
+void AsyncWebServerRequest::send(AsyncBlockStream &stream, const String& contentType, size_t len,
+                                 AwsTemplateProcessor callback)
+{
+  send(beginResponse(stream, contentType, len, callback));
+}
+
+/////////////////////////////////////////////////
+
 void AsyncWebServerRequest::send(const String& contentType, size_t len, AwsResponseFiller callback,
                                  AwsTemplateProcessor templateCallback)
 {
@@ -1376,6 +1971,8 @@ void AsyncWebServerRequest::requestAuthentication(const char * realm, bool isDig
 
 bool AsyncWebServerRequest::hasArg(const char* name) const
 {
+  _parseParams();
+
   for (const auto& arg : _params)
   {
     if (arg->name() == name)
@@ -1391,6 +1988,8 @@ bool AsyncWebServerRequest::hasArg(const char* name) const
 
 const String& AsyncWebServerRequest::arg(const String& name) const
 {
+  _parseParams();
+
   for (const auto& arg : _params)
   {
     if (arg->name() == name)
@@ -1456,34 +2055,11 @@ const String& AsyncWebServerRequest::headerName(size_t i) const
 
 String AsyncWebServerRequest::urlDecode(const String& text) const
 {
-  char temp[] = "0x00";
-  unsigned int len = text.length();
-  unsigned int i = 0;
-  String decoded = String();
-  decoded.reserve(len); // Allocate the string internal buffer - never longer from source text
-
-  while (i < len)
-  {
-    char decodedChar;
-    char encodedChar = text.charAt(i++);
-
-    if ((encodedChar == '%') && (i + 1 < len))
-    {
-      temp[2] = text.charAt(i++);
-      temp[3] = text.charAt(i++);
-      decodedChar = strtol(temp, NULL, 16);
-    }
-    else if (encodedChar == '+')
-    {
-      decodedChar = ' ';
-    }
-    else
-    {
-      decodedChar = encodedChar;  // normal ascii char
-    }
+  String decoded = text;
+  size_t len = _urlDecodeInPlace(decoded.begin(), decoded.length());
 
-    decoded.concat(decodedChar);
-  }
+  if (len < decoded.length())
+    decoded.remove(len);
 
   return decoded;
 }
@@ -44,6 +44,60 @@
 
 // It is possible to restore these defines, but one can use _min and _max instead. Or std::min, std::max.
 
+class AsyncWebTemplate;
+
+/////////////////////////////////////////////////
+
+/*
+   Ring buffer for the template spill data : bytes pushed back at the front are read first,
+   so both ends are O(1) per byte, whatever is already buffered. Grows as needed
+ * */
+
+class AsyncWebRingBuffer
+{
+  private:
+    uint8_t* _buf;
+    size_t _capacity;         // power of 2
+    size_t _head;             // index of the first byte
+    size_t _size;
+
+    bool _reserve(size_t size);
+
+  public:
+    AsyncWebRingBuffer() : _buf(nullptr), _capacity(0), _head(0), _size(0) {}
+    AsyncWebRingBuffer(const AsyncWebRingBuffer&) = delete;
+    AsyncWebRingBuffer& operator = (const AsyncWebRingBuffer&) = delete;
+
+    /////////////////////////////////////////////////
+
+    ~AsyncWebRingBuffer()
+    {
+      free(_buf);
+    }
+
+    /////////////////////////////////////////////////
+
+    inline size_t size() const
+    {
+      return _size;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline bool empty() const
+    {
+      return _size == 0;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Put data before the buffered bytes
+    bool push_front(const uint8_t* data, size_t len);
+
+    // Read and remove up to len bytes from the front
+    size_t pop_front(uint8_t* data, size_t len);
+};
+
 class AsyncBasicResponse: public AsyncWebServerResponse
 {
   private:
@@ -81,19 +135,38 @@ class AsyncAbstractResponse: public AsyncWebServerResponse
 {
   private:
     String _head;
-    // Data is inserted into cache at begin().
-    // This is inefficient with vector, but if we use some other container,
-    // we won't be able to access it as contiguous array of bytes when reading from it,
-    // so by gaining performance in one place, we'll lose it in another.
-    std::vector<uint8_t> _cache;
+    // Send buffer kept for the whole response and grown to the largest TCP window seen
+    uint8_t* _sendBuffer;
+    size_t _sendBufferSize;
+    uint8_t* _reserveSendBuffer(size_t size);
+    size_t _sendHead(AsyncClient* client, size_t space);
+    // Template data that didn't fit in the send buffer, pushed back at the front and read before the content
+    AsyncWebRingBuffer _cache;
     size_t _readDataFromCacheOrContent(uint8_t* data, const size_t len);
     size_t _fillBufferAndProcessTemplates(uint8_t* buf, size_t maxLen);
 
+    // Precompiled template : literal bytes are streamed from the source, values are sent between them
+    AsyncWebTemplate* _template;
+    size_t _templatePos;                  // read position in the source
+    size_t _templateIndex;                // next placeholder
+    std::vector<String> _templateValues;  // values computed before sending, see _prepareTemplate()
+    String _templateValue;                // value being sent
+    size_t _templateValueSent;
+    void _prepareTemplate();
+    size_t _fillBufferFromTemplate(uint8_t* buf, size_t maxLen);
+
   protected:
     AwsTemplateProcessor _callback;
 
+    // Responses whose content can be scanned in advance return their compiled template
+    virtual AsyncWebTemplate* _compileTemplate()
+    {
+      return nullptr;
+    }
+
   public:
     AsyncAbstractResponse(AwsTemplateProcessor callback = nullptr);
+    virtual ~AsyncAbstractResponse();
     void _respond(AsyncWebServerRequest *request);
     size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
 
@@ -124,8 +197,12 @@ class AsyncProgmemResponse: public AsyncAbstractResponse
 {
   private:
     const uint8_t * _content;
+    size_t _length;
     size_t _readLength;
 
+  protected:
+    virtual AsyncWebTemplate* _compileTemplate() override;
+
   public:
     AsyncProgmemResponse(int code, const String& contentType, const uint8_t * content, size_t len,
                          AwsTemplateProcessor callback = nullptr);
@@ -150,6 +227,90 @@ class AsyncProgmemResponse: public AsyncAbstractResponse
 
 #define TEMPLATE_PARAM_NAME_LENGTH 32
 
+// Number of compiled templates kept, for files (by path, size and last write time) and PROGMEM content
+#ifndef TEMPLATE_CACHE_SIZE
+  #define TEMPLATE_CACHE_SIZE         4
+#endif
+
+// Values of the placeholders are computed before sending, up to this total size, so the response has a Content-Length.
+// Beyond it, the remaining values are computed while sending and the response is chunked
+#ifndef TEMPLATE_VALUES_BUFFER_SIZE
+  #define TEMPLATE_VALUES_BUFFER_SIZE 1024
+#endif
+
+/////////////////////////////////////////////////
+
+/*
+   Template content scanned once : offsets and names of its placeholders.
+   A placeholder is TEMPLATE_PLACEHOLDER, 1 to TEMPLATE_PARAM_NAME_LENGTH other characters and TEMPLATE_PLACEHOLDER.
+   A doubled TEMPLATE_PLACEHOLDER is an escaped one, and is kept with an empty name
+ * */
+
+class AsyncWebTemplate
+{
+  public:
+    typedef struct
+    {
+      size_t  offset;       // in the source
+      uint8_t length;       // of the placeholder in the source, including both TEMPLATE_PLACEHOLDER
+      String  name;         // empty for an escaped TEMPLATE_PLACEHOLDER
+    } Placeholder;
+
+  private:
+    String    _key;
+    size_t    _size;
+    time_t    _stamp;
+    uint16_t  _refs;
+    uint32_t  _used;
+    bool      _cached;
+    std::vector<Placeholder> _placeholders;
+
+    // Scanner state
+    size_t    _open;          // offset of an unclosed TEMPLATE_PLACEHOLDER, or SIZE_MAX
+    uint8_t   _nameLength;
+    char      _name[TEMPLATE_PARAM_NAME_LENGTH + 1];
+
+    AsyncWebTemplate(const String& key, size_t size, time_t stamp);
+    void _scan(const uint8_t* data, size_t len, size_t offset);
+
+    static std::vector<AsyncWebTemplate*>& _cache();
+    static AsyncWebTemplate* _find(const String& key, size_t size, time_t stamp);
+    static void _insert(AsyncWebTemplate* tmpl);
+
+  public:
+    // Compiled template of the file or content, from the cache if unchanged. Release it with release()
+    static AsyncWebTemplate* fromFile(File& file, const String& path);
+    static AsyncWebTemplate* fromProgmem(const uint8_t* content, size_t len);
+    static void release(AsyncWebTemplate* tmpl);
+
+    /////////////////////////////////////////////////
+
+    inline size_t size() const
+    {
+      return _size;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline const std::vector<Placeholder>& placeholders() const
+    {
+      return _placeholders;
+    }
+};
+
+/////////////////////////////////////////////////
+
+// Max number of ranges served as multipart/byteranges, a Range header asking for more gets the whole file.
+// 1 only serves single ranges
+#ifndef MAX_BYTE_RANGES
+  #define MAX_BYTE_RANGES       4
+#endif
+
+typedef enum
+{
+  RANGE_IGNORED, RANGE_SATISFIABLE, RANGE_NOT_SATISFIABLE
+} WebRangeResult;
+
 /////////////////////////////////////////////////
 
 class AsyncFileResponse: public AsyncAbstractResponse
@@ -157,7 +318,28 @@ class AsyncFileResponse: public AsyncAbstractResponse
   private:
     File _content;
     String _path;
+
+    // First and last byte of each requested range
+    struct
+    {
+      size_t first;
+      size_t last;
+    } _ranges[MAX_BYTE_RANGES];
+
+    uint8_t _rangeCount;
+    uint8_t _rangeIndex;      // next range to send
+    size_t _rangeLeft;        // bytes of the current range still to read
+    String _rangePart;        // multipart boundary and headers before the current range, or the closing boundary
+    size_t _rangePartSent;
+    String _rangeBoundary;
+    String _rangeContentType;
+
     void _setContentType(const String& path);
+    virtual AsyncWebTemplate* _compileTemplate() override;
+    WebRangeResult _parseRange(const char* spec, size_t size);
+    bool _ifRangeMatches(const String& validator);
+    String _rangePartHead(uint8_t index, size_t size) const;
+    void _applyRange(AsyncWebServerRequest *request);
 
   public:
     AsyncFileResponse(FS &fs, const String& path, const String& contentType = String(), bool download = false,
@@ -167,11 +349,17 @@ class AsyncFileResponse: public AsyncAbstractResponse
 
     ~AsyncFileResponse();
 
+    // Content type from the file extension, "text/plain" when unknown. Doesn't allocate.
+    static const char* contentTypeFor(const String& path);
+    // Add or replace the content type of an extension, with or without the leading '.'
+    static void addContentType(const String& extension, const String& contentType);
+
     inline bool _sourceValid() const
     {
       return !!(_content);
     }
 
+    void _respond(AsyncWebServerRequest *request);
     virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
 };
 
@@ -181,9 +369,12 @@ class AsyncStreamResponse: public AsyncAbstractResponse
 {
   private:
     Stream *_content;
+    AsyncBlockStream *_blockContent;    // same stream when it supports readBlock(), else nullptr
 
   public:
     AsyncStreamResponse(Stream &stream, const String& contentType, size_t len, AwsTemplateProcessor callback = nullptr);
+    AsyncStreamResponse(AsyncBlockStream &stream, const String& contentType, size_t len,
+                        AwsTemplateProcessor callback = nullptr);
 
     /////////////////////////////////////////////////
 
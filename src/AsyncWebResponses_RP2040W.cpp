@@ -53,150 +53,92 @@ void* memchr(void* ptr, int ch, size_t count)
 /*
    Abstract Response
  * */
-const char* AsyncWebServerResponse::_responseCodeToString(int code)
+// Sorted by code for the binary search in _responseCodeToString()
+typedef struct
 {
-  switch (code)
-  {
-    case 100:
-      return "Continue";
-
-    case 101:
-      return "Switching Protocols";
-
-    case 200:
-      return "OK";
-
-    case 201:
-      return "Created";
-
-    case 202:
-      return "Accepted";
-
-    case 203:
-      return "Non-Authoritative Information";
-
-    case 204:
-      return "No Content";
-
-    case 205:
-      return "Reset Content";
-
-    case 206:
-      return "Partial Content";
-
-    case 300:
-      return "Multiple Choices";
-
-    case 301:
-      return "Moved Permanently";
-
-    case 302:
-      return "Found";
-
-    case 303:
-      return "See Other";
-
-    case 304:
-      return "Not Modified";
-
-    case 305:
-      return "Use Proxy";
-
-    case 307:
-      return "Temporary Redirect";
-
-    case 400:
-      return "Bad Request";
-
-    case 401:
-      return "Unauthorized";
-
-    case 402:
-      return "Payment Required";
-
-    case 403:
-      return "Forbidden";
-
-    case 404:
-      return "Not Found";
-
-    case 405:
-      return "Method Not Allowed";
-
-    case 406:
-      return "Not Acceptable";
-
-    case 407:
-      return "Proxy Authentication Required";
-
-    case 408:
-      return "Request Time-out";
-
-    case 409:
-      return "Conflict";
-
-    case 410:
-      return "Gone";
-
-    case 411:
-      return "Length Required";
-
-    case 412:
-      return "Precondition Failed";
+  uint16_t    code;
+  const char* text;
+} AsyncWebStatusText;
 
-    case 413:
-      return "Request Entity Too Large";
-
-    case 414:
-      return "Request-URI Too Large";
-
-    case 415:
-      return "Unsupported Media Type";
-
-    case 416:
-      return "Requested range not satisfiable";
-
-    case 417:
-      return "Expectation Failed";
-
-    case 500:
-      return "Internal Server Error";
-
-    case 501:
-      return "Not Implemented";
-
-    case 502:
-      return "Bad Gateway";
+static constexpr AsyncWebStatusText _statusTexts[] =
+{
+  { 100, "Continue" },
+  { 101, "Switching Protocols" },
+  { 200, "OK" },
+  { 201, "Created" },
+  { 202, "Accepted" },
+  { 203, "Non-Authoritative Information" },
+  { 204, "No Content" },
+  { 205, "Reset Content" },
+  { 206, "Partial Content" },
+  { 300, "Multiple Choices" },
+  { 301, "Moved Permanently" },
+  { 302, "Found" },
+  { 303, "See Other" },
+  { 304, "Not Modified" },
+  { 305, "Use Proxy" },
+  { 307, "Temporary Redirect" },
+  { 400, "Bad Request" },
+  { 401, "Unauthorized" },
+  { 402, "Payment Required" },
+  { 403, "Forbidden" },
+  { 404, "Not Found" },
+  { 405, "Method Not Allowed" },
+  { 406, "Not Acceptable" },
+  { 407, "Proxy Authentication Required" },
+  { 408, "Request Time-out" },
+  { 409, "Conflict" },
+  { 410, "Gone" },
+  { 411, "Length Required" },
+  { 412, "Precondition Failed" },
+  { 413, "Request Entity Too Large" },
+  { 414, "Request-URI Too Large" },
+  { 415, "Unsupported Media Type" },
+  { 416, "Requested range not satisfiable" },
+  { 417, "Expectation Failed" },
+  { 500, "Internal Server Error" },
+  { 501, "Not Implemented" },
+  { 502, "Bad Gateway" },
+  { 503, "Service Unavailable" },
+  { 504, "Gateway Time-out" },
+  { 505, "HTTP Version not supported" },
+};
+
+static constexpr size_t _statusTextsCount = sizeof(_statusTexts) / sizeof(_statusTexts[0]);
 
-    case 503:
-      return "Service Unavailable";
+const char* AsyncWebServerResponse::_responseCodeToString(int code)
+{
+  size_t lo = 0;
+  size_t hi = _statusTextsCount;
 
-    case 504:
-      return "Gateway Time-out";
+  while (lo < hi)
+  {
+    size_t mid = (lo + hi) / 2;
 
-    case 505:
-      return "HTTP Version not supported";
+    if (_statusTexts[mid].code == code)
+      return _statusTexts[mid].text;
 
-    default:
-      return "";
+    if (_statusTexts[mid].code < code)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
+
+  return "";
 }
 
 /////////////////////////////////////////////////
 
 AsyncWebServerResponse::AsyncWebServerResponse()
   : _code(0)
-  , _headers(LinkedList<AsyncWebHeader * >([](AsyncWebHeader * h)
+  , _headers(IntrusiveLinkedList<AsyncWebHeader>([](AsyncWebHeader * h)
 {
   delete h;
 }))
 , _contentType(), _contentLength(0), _sendContentLength(true), _chunked(false), _headLength(0)
-, _sentLength(0), _ackedLength(0), _writtenLength(0), _state(RESPONSE_SETUP)
+, _sentLength(0), _ackedLength(0), _writtenLength(0), _state(RESPONSE_SETUP), _connectionKeepAlive(false)
 {
-  for (auto header : DefaultHeaders::Instance())
-  {
-    _headers.add(new AsyncWebHeader(header->name(), header->value()));
-  }
+  // DefaultHeaders are appended from their pre-rendered block in _assembleHead()
 }
 
 /////////////////////////////////////////////////
@@ -239,39 +181,166 @@ void AsyncWebServerResponse::addHeader(const String& name, const String& value)
 
 /////////////////////////////////////////////////
 
+void AsyncWebServerResponse::_addConnectionHeader(AsyncWebServerRequest *request)
+{
+  // Without Content-Length or chunked encoding, the end of the body is signalled by closing the connection
+  _connectionKeepAlive = request->_keepAlive && (_sendContentLength || (_chunked && request->version()));
+
+  if (!_connectionKeepAlive)
+  {
+    request->_keepAlive = false;
+    addHeader("Connection", "close");
+
+    return;
+  }
+
+  addHeader("Connection", "keep-alive");
+
+  String keepAlive = "timeout=";
+  keepAlive += String(request->_server->keepAliveTimeout());
+
+  if (request->_server->keepAliveMaxRequests())
+  {
+    keepAlive += ", max=";
+    keepAlive += String(request->_server->keepAliveMaxRequests() - request->_requestCount - 1);
+  }
+
+  addHeader("Keep-Alive", keepAlive);
+}
+
+/////////////////////////////////////////////////
+
+bool AsyncWebServerResponse::_hasHeader(const String& name)
+{
+  for (const auto& header : _headers)
+  {
+    if (header->name().equalsIgnoreCase(name))
+      return true;
+  }
+
+  return false;
+}
+
+/////////////////////////////////////////////////
+
 String AsyncWebServerResponse::_assembleHead(uint8_t version)
 {
+  const DefaultHeaders& defaults = DefaultHeaders::Instance();
+
+  // A header set on the response replaces the default header of the same name.
+  // Only then are the default headers written one by one instead of as one block.
+  bool defaultsOverridden = false;
+
+  if (!defaults.isEmpty())
+  {
+    for (const auto& header : _headers)
+    {
+      if (defaults.hasHeader(header->name()))
+      {
+        defaultsOverridden = true;
+
+        break;
+      }
+    }
+  }
+
   if (version)
   {
-    addHeader("Accept-Ranges", "none");
+    if (!_hasHeader("Accept-Ranges") && !defaults.hasHeader("Accept-Ranges"))
+      addHeader("Accept-Ranges", "none");
 
     if (_chunked)
       addHeader("Transfer-Encoding", "chunked");
   }
 
-  String out = String();
-  int bufSize = 300;
-  char buf[bufSize];
+  // Size the head exactly first so it's built in a single allocation, whatever the header lengths
+  const char* codeText = _responseCodeToString(_code);
+  char codeBuf[12];
+  char lengthBuf[12];
+
+  size_t codeLen = snprintf(codeBuf, sizeof(codeBuf), "%d", _code);
+  size_t lengthLen = _sendContentLength ? snprintf(lengthBuf, sizeof(lengthBuf), "%lu", (unsigned long) _contentLength) : 0;
 
-  snprintf(buf, bufSize, "HTTP/1.%d %d %s\r\n", version, _code, _responseCodeToString(_code));
-  out.concat(buf);
+  // "HTTP/1.x " + code + " " + text + "\r\n"
+  size_t size = 9 + codeLen + 1 + strlen(codeText) + 2;
 
   if (_sendContentLength)
+    size += sizeof("Content-Length: ") - 1 + lengthLen + 2;
+
+  if (_contentType.length())
+    size += sizeof("Content-Type: ") - 1 + _contentType.length() + 2;
+
+  if (!defaultsOverridden)
   {
-    snprintf(buf, bufSize, "Content-Length: %d\r\n", _contentLength);
-    out.concat(buf);
+    size += defaults.block().length();
+  }
+  else
+  {
+    for (const auto& header : defaults)
+    {
+      if (!_hasHeader(header->name()))
+        size += header->name().length() + 2 + header->value().length() + 2;
+    }
+  }
+
+  for (const auto& header : _headers)
+  {
+    size += header->name().length() + 2 + header->value().length() + 2;
+  }
+
+  size += 2;
+
+  String out;
+
+  if (!out.reserve(size))
+  {
+    AWS_LOGERROR1("AsyncWebServerResponse::_assembleHead: no memory for head, size =", size);
+  }
+
+  out.concat(version ? "HTTP/1.1 " : "HTTP/1.0 ");
+  out.concat(codeBuf, codeLen);
+  out.concat(' ');
+  out.concat(codeText);
+  out.concat("\r\n");
+
+  if (_sendContentLength)
+  {
+    out.concat("Content-Length: ");
+    out.concat(lengthBuf, lengthLen);
+    out.concat("\r\n");
   }
 
   if (_contentType.length())
   {
-    snprintf(buf, bufSize, "Content-Type: %s\r\n", _contentType.c_str());
-    out.concat(buf);
+    out.concat("Content-Type: ");
+    out.concat(_contentType);
+    out.concat("\r\n");
+  }
+
+  if (!defaultsOverridden)
+  {
+    out.concat(defaults.block());
+  }
+  else
+  {
+    for (const auto& header : defaults)
+    {
+      if (!_hasHeader(header->name()))
+      {
+        out.concat(header->name());
+        out.concat(": ");
+        out.concat(header->value());
+        out.concat("\r\n");
+      }
+    }
   }
 
   for (const auto& header : _headers)
   {
-    snprintf(buf, bufSize, "%s: %s\r\n", header->name().c_str(), header->value().c_str());
-    out.concat(buf);
+    out.concat(header->name());
+    out.concat(": ");
+    out.concat(header->value());
+    out.concat("\r\n");
   }
 
   _headers.free();
@@ -344,14 +413,22 @@ AsyncProgmemResponse::AsyncProgmemResponse(int code, const String& contentType,
   _content       = content;
   _contentType   = contentType;
   _contentLength = len;
+  _length        = len;
   _readLength    = 0;
 }
 
 ////////////////////////////////////////////////
 
+AsyncWebTemplate* AsyncProgmemResponse::_compileTemplate()
+{
+  return AsyncWebTemplate::fromProgmem(_content, _length);
+}
+
+////////////////////////////////////////////////
+
 size_t AsyncProgmemResponse::_fillBuffer(uint8_t *data, size_t len)
 {
-  size_t left = _contentLength - _readLength;
+  size_t left = _length - _readLength;
 
   if (left > len)
   {
@@ -392,8 +469,6 @@ AsyncBasicResponse::AsyncBasicResponse(int code, const String& contentType, cons
     if (!_contentType.length())
       _contentType = "text/plain";
   }
-
-  addHeader("Connection", "close");
 }
 
 /////////////////////////////////////////////////
@@ -418,8 +493,6 @@ AsyncBasicResponse::AsyncBasicResponse(int code, const String& contentType, cons
     if (!_contentType.length())
       _contentType = "text/plain";
   }
-
-  addHeader("Connection", "close");
 }
 
 /////////////////////////////////////////////////
@@ -442,6 +515,7 @@ AsyncBasicResponse::AsyncBasicResponse(int code, const String& contentType, cons
 
 void AsyncBasicResponse::_respond(AsyncWebServerRequest *request)
 {
+  _addConnectionHeader(request);
   _state = RESPONSE_HEADERS;
   String out = _assembleHead(request->version());
   size_t outLen = out.length();
@@ -680,7 +754,9 @@ size_t AsyncBasicResponse::_ack(AsyncWebServerRequest *request, size_t len, uint
    Abstract Response
  * */
 
-AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _callback(callback)
+AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback)
+  : _sendBuffer(nullptr), _sendBufferSize(0), _template(nullptr), _templatePos(0), _templateIndex(0),
+    _templateValueSent(0), _callback(callback)
 {
   // In case of template processing, we're unable to determine real response size
   if (callback)
@@ -693,9 +769,71 @@ AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _ca
 
 /////////////////////////////////////////////////
 
+AsyncAbstractResponse::~AsyncAbstractResponse()
+{
+  AsyncWebTemplate::release(_template);
+
+  if (_sendBuffer)
+    free(_sendBuffer);
+}
+
+/////////////////////////////////////////////////
+
+uint8_t* AsyncAbstractResponse::_reserveSendBuffer(size_t size)
+{
+  if (size > _sendBufferSize)
+  {
+    uint8_t* buf = (uint8_t *) realloc(_sendBuffer, size);
+
+    if (!buf)
+    {
+      AWS_LOGDEBUG1("AsyncAbstractResponse::_reserveSendBuffer realloc failed, size =", size);
+
+      return nullptr;
+    }
+
+    _sendBuffer = buf;
+    _sendBufferSize = size;
+  }
+
+  return _sendBuffer;
+}
+
+/////////////////////////////////////////////////
+
+// Queue as much of the pending head as fits, the rest goes out on the next ack
+size_t AsyncAbstractResponse::_sendHead(AsyncClient* client, size_t space)
+{
+  size_t headLen = _head.length();
+  size_t written = client->add(_head.c_str(), (headLen > space) ? space : headLen);
+
+  if (written)
+  {
+    client->send();
+    _writtenLength += written;
+
+    if (written == headLen)
+      _head = String();
+    else
+      _head.remove(0, written);
+  }
+
+  return written;
+}
+
+/////////////////////////////////////////////////
+
 void AsyncAbstractResponse::_respond(AsyncWebServerRequest *request)
 {
-  addHeader("Connection", "close");
+  if (_callback && !_template)
+  {
+    _template = _compileTemplate();
+
+    if (_template)
+      _prepareTemplate();
+  }
+
+  _addConnectionHeader(request);
   _head = _assembleHead(request->version());
   _state = RESPONSE_HEADERS;
   _ack(request, 0, 0);
@@ -707,48 +845,47 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
 {
   RP2040W_AWS_UNUSED(time);
 
+  AsyncClient* client = request->client();
+
   if (!_sourceValid())
   {
     _state = RESPONSE_FAILED;
-    request->client()->close();
+    client->close();
 
     return 0;
   }
 
   _ackedLength += len;
-  size_t space = request->client()->space();
+  size_t space = client->space();
 
   size_t headLen = _head.length();
 
   if (_state == RESPONSE_HEADERS)
   {
-    if (space >= headLen)
-    {
-      _state = RESPONSE_CONTENT;
-      space -= headLen;
-    }
-    else
-    {
-      String out = _head.substring(0, space);
-      _head = _head.substring(space);
-      _writtenLength += request->client()->write(out.c_str(), out.length());
-
-      return out.length();
-    }
+    _state = RESPONSE_CONTENT;
   }
 
   if (_state == RESPONSE_CONTENT)
   {
+    // Content only goes out once the whole head is queued in front of it
+    if (headLen >= space)
+    {
+      return _sendHead(client, space);
+    }
+
+    space -= headLen;
+
     size_t outLen;
 
     if (_chunked)
     {
       if (space <= 8)
       {
-        return 0;
+        return _sendHead(client, headLen);
       }
 
-      outLen = space;
+      // Chunk size is written as at most 4 hex digits
+      outLen = (space > 0xFFFF + 8) ? 0xFFFF + 8 : space;
     }
     else if (!_sendContentLength)
     {
@@ -759,18 +896,23 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
       outLen = ((_contentLength - _sentLength) > space) ? space : (_contentLength - _sentLength);
     }
 
-    uint8_t *buf = (uint8_t *)malloc(outLen + headLen);
-
-    if (!buf)
+    // All the content is out, or there is none (Content-Length: 0) : only the head is left to queue
+    if (outLen == 0)
     {
-      AWS_LOGDEBUG1("AsyncAbstractResponse::_ack malloc failed, size =", outLen + headLen);
+      size_t written = _sendHead(client, headLen);
+
+      if (_sentLength == _contentLength)
+        _state = RESPONSE_WAIT_ACK;
 
-      return 0;
+      return written;
     }
 
-    if (headLen)
+    // The head is queued straight from _head, only the content goes through the send buffer
+    uint8_t *buf = _reserveSendBuffer(outLen);
+
+    if (!buf)
     {
-      memcpy(buf, _head.c_str(), _head.length());
+      return _sendHead(client, headLen);
     }
 
     size_t readLen = 0;
@@ -779,17 +921,16 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
     {
       // HTTP 1.1 allows leading zeros in chunk length. Or spaces may be added.
       // See RFC2616 sections 2, 3.6.1.
-      readLen = _fillBufferAndProcessTemplates(buf + headLen + 6, outLen - 8);
+      readLen = _fillBufferAndProcessTemplates(buf + 6, outLen - 8);
 
       if (readLen == RESPONSE_TRY_AGAIN)
       {
-        free(buf);
-        return 0;
+        return _sendHead(client, headLen);
       }
 
-      outLen = sprintf((char*)buf + headLen, "%x", readLen) + headLen;
+      outLen = sprintf((char*)buf, "%x", readLen);
 
-      while (outLen < headLen + 4)
+      while (outLen < 4)
         buf[outLen++] = ' ';
 
       buf[outLen++] = '\r';
@@ -802,46 +943,40 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
     }
     else
     {
-      readLen = _fillBufferAndProcessTemplates(buf + headLen, outLen);
+      readLen = _fillBufferAndProcessTemplates(buf, outLen);
 
       if (readLen == RESPONSE_TRY_AGAIN)
       {
-        free(buf);
-
-        return 0;
+        return _sendHead(client, headLen);
       }
 
-      outLen = readLen + headLen;
+      outLen = readLen;
     }
 
     if (headLen)
     {
+      _writtenLength += client->add(_head.c_str(), headLen);
       _head = String();
     }
 
     if (outLen)
     {
-      _writtenLength += request->client()->write((const char*)buf, outLen);
+      _writtenLength += client->add((const char*)buf, outLen);
     }
 
-    if (_chunked)
+    if (headLen || outLen)
     {
-      _sentLength += readLen;
-    }
-    else
-    {
-      _sentLength += outLen - headLen;
+      client->send();
     }
 
-    free(buf);
+    _sentLength += readLen;
 
     if ((_chunked && readLen == 0) || (!_sendContentLength && outLen == 0) || (!_chunked && _sentLength == _contentLength))
     {
       _state = RESPONSE_WAIT_ACK;
     }
 
-    return outLen;
-
+    return headLen + outLen;
   }
   else if (_state == RESPONSE_WAIT_ACK)
   {
@@ -850,7 +985,7 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
       _state = RESPONSE_END;
 
       if (!_chunked && !_sendContentLength)
-        request->client()->close(true);
+        client->close(true);
     }
   }
 
@@ -859,6 +994,85 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
 
 /////////////////////////////////////////////////
 
+bool AsyncWebRingBuffer::_reserve(size_t size)
+{
+  if (size <= _capacity)
+    return true;
+
+  size_t capacity = _capacity ? _capacity : 64;
+
+  while (capacity < size)
+    capacity <<= 1;
+
+  uint8_t* buf = (uint8_t*) malloc(capacity);
+
+  if (!buf)
+  {
+    AWS_LOGERROR1("AsyncWebRingBuffer: malloc failed, size =", capacity);
+
+    return false;
+  }
+
+  // Unwrap the content at the start of the new buffer
+  const size_t count = _size;
+
+  pop_front(buf, count);
+  _size = count;
+
+  free(_buf);
+
+  _buf      = buf;
+  _capacity = capacity;
+  _head     = 0;
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+bool AsyncWebRingBuffer::push_front(const uint8_t* data, size_t len)
+{
+  if (!len)
+    return true;
+
+  if (!_reserve(_size + len))
+    return false;
+
+  _head = (_head - len) & (_capacity - 1);
+
+  const size_t first = std::min(len, _capacity - _head);
+
+  memcpy(_buf + _head, data, first);
+  memcpy(_buf, data + first, len - first);
+
+  _size += len;
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+size_t AsyncWebRingBuffer::pop_front(uint8_t* data, size_t len)
+{
+  if (len > _size)
+    len = _size;
+
+  if (!len)
+    return 0;
+
+  const size_t first = std::min(len, _capacity - _head);
+
+  memcpy(data, _buf + _head, first);
+  memcpy(data + first, _buf, len - first);
+
+  _head = (_head + len) & (_capacity - 1);
+  _size -= len;
+
+  return len;
+}
+
+/////////////////////////////////////////////////
+
 size_t AsyncAbstractResponse::_readDataFromCacheOrContent(uint8_t* data, const size_t len)
 {
   // If we have something in cache, copy it to buffer
@@ -866,8 +1080,7 @@ size_t AsyncAbstractResponse::_readDataFromCacheOrContent(uint8_t* data, const s
 
   if (readFromCache)
   {
-    memcpy(data, _cache.data(), readFromCache);
-    _cache.erase(_cache.begin(), _cache.begin() + readFromCache);
+    _cache.pop_front(data, readFromCache);
   }
 
   // If we need to read more...
@@ -879,11 +1092,127 @@ size_t AsyncAbstractResponse::_readDataFromCacheOrContent(uint8_t* data, const s
 
 /////////////////////////////////////////////////
 
+// Compute the values in advance, up to TEMPLATE_VALUES_BUFFER_SIZE, to send the response with a Content-Length
+void AsyncAbstractResponse::_prepareTemplate()
+{
+  const auto& placeholders = _template->placeholders();
+
+  size_t length = _template->size();
+  size_t buffered = 0;
+
+  _templateValues.reserve(placeholders.size());
+
+  for (const auto& placeholder : placeholders)
+  {
+    length -= placeholder.length;
+
+    if (!placeholder.name.length())
+    {
+      // Escaped TEMPLATE_PLACEHOLDER
+      length++;
+      _templateValues.push_back(String());
+
+      continue;
+    }
+
+    _templateValues.push_back(_callback(placeholder.name));
+
+    buffered += _templateValues.back().length();
+    length   += _templateValues.back().length();
+
+    if (buffered > TEMPLATE_VALUES_BUFFER_SIZE)
+      return;
+  }
+
+  _contentLength = length;
+  _sendContentLength = true;
+  _chunked = false;
+}
+
+/////////////////////////////////////////////////
+
+size_t AsyncAbstractResponse::_fillBufferFromTemplate(uint8_t* data, size_t len)
+{
+  const auto& placeholders = _template->placeholders();
+
+  size_t filled = 0;
+
+  while (filled < len)
+  {
+    if (_templateValueSent < _templateValue.length())
+    {
+      size_t valueLen = _templateValue.length() - _templateValueSent;
+
+      if (valueLen > len - filled)
+        valueLen = len - filled;
+
+      memcpy(data + filled, _templateValue.c_str() + _templateValueSent, valueLen);
+      _templateValueSent += valueLen;
+      filled += valueLen;
+
+      continue;
+    }
+
+    // Literal bytes, up to the next placeholder
+    size_t literalLen = len - filled;
+
+    if (_templateIndex < placeholders.size() && placeholders[_templateIndex].offset - _templatePos < literalLen)
+      literalLen = placeholders[_templateIndex].offset - _templatePos;
+
+    if (literalLen)
+    {
+      const size_t readLen = _fillBuffer(data + filled, literalLen);
+
+      if (readLen == 0)
+        break;
+
+      _templatePos += readLen;
+      filled += readLen;
+
+      continue;
+    }
+
+    // Skip the placeholder in the source and send its value instead
+    const auto& placeholder = placeholders[_templateIndex];
+    uint8_t skip[TEMPLATE_PARAM_NAME_LENGTH + 2];
+    size_t skipped = 0;
+
+    while (skipped < placeholder.length)
+    {
+      const size_t readLen = _fillBuffer(skip, placeholder.length - skipped);
+
+      if (readLen == 0)
+        return filled;
+
+      skipped += readLen;
+    }
+
+    _templatePos += skipped;
+
+    if (!placeholder.name.length())
+      _templateValue = String((char) TEMPLATE_PLACEHOLDER);
+    else if (_templateIndex < _templateValues.size())
+      _templateValue = std::move(_templateValues[_templateIndex]);
+    else
+      _templateValue = _callback(placeholder.name);
+
+    _templateValueSent = 0;
+    _templateIndex++;
+  }
+
+  return filled;
+}
+
+/////////////////////////////////////////////////
+
 size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size_t len)
 {
   if (!_callback)
     return _fillBuffer(data, len);
 
+  if (_template)
+    return _fillBufferFromTemplate(data, len);
+
   const size_t originalLen = len;
   len = _readDataFromCacheOrContent(data, len);
 
@@ -906,7 +1235,7 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size
     if (pTemplateEnd)
     {
       // prepare argument to callback
-      const size_t paramNameLength = std::min(sizeof(buf) - 1, (unsigned int)(pTemplateEnd - pTemplateStart - 1));
+      const size_t paramNameLength = std::min(sizeof(buf) - 1, (size_t)(pTemplateEnd - pTemplateStart - 1));
 
       if (paramNameLength)
       {
@@ -927,8 +1256,20 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size
     {
       // closing placeholder not found, check if it's in the remaining file data
       memcpy(buf, pTemplateStart + 1, &data[len - 1] - pTemplateStart);
-      const size_t readFromCacheOrContent = _readDataFromCacheOrContent(buf + (&data[len - 1] - pTemplateStart),
-                                                                        TEMPLATE_PARAM_NAME_LENGTH + 2 - (&data[len - 1] - pTemplateStart + 1));
+      // Streams may return less than asked, read until the longest name and its closing placeholder fit
+      const size_t readAhead = TEMPLATE_PARAM_NAME_LENGTH + 2 - (&data[len - 1] - pTemplateStart + 1);
+      size_t readFromCacheOrContent = 0;
+
+      while (readFromCacheOrContent < readAhead)
+      {
+        const size_t readLen = _readDataFromCacheOrContent(buf + (&data[len - 1] - pTemplateStart) + readFromCacheOrContent,
+                                                           readAhead - readFromCacheOrContent);
+
+        if (readLen == 0 || readLen == RESPONSE_TRY_AGAIN)
+          break;
+
+        readFromCacheOrContent += readLen;
+      }
 
       if (readFromCacheOrContent)
       {
@@ -940,14 +1281,13 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size
           *pTemplateEnd = 0;
           paramName = String(reinterpret_cast<char*>(buf));
           // Copy remaining read-ahead data into cache
-          _cache.insert(_cache.begin(), pTemplateEnd + 1, buf + (&data[len - 1] - pTemplateStart) + readFromCacheOrContent);
+          _cache.push_front(pTemplateEnd + 1, buf + (&data[len - 1] - pTemplateStart) + readFromCacheOrContent - pTemplateEnd - 1);
           pTemplateEnd = &data[len - 1];
         }
         else // closing placeholder not found in file data, store found percent symbol as is and advance to the next position
         {
           // but first, store read file data in cache
-          _cache.insert(_cache.begin(), buf + (&data[len - 1] - pTemplateStart),
-                        buf + (&data[len - 1] - pTemplateStart) + readFromCacheOrContent);
+          _cache.push_front(buf + (&data[len - 1] - pTemplateStart), readFromCacheOrContent);
           ++pTemplateStart;
         }
       }
@@ -974,7 +1314,8 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size
       if ((pTemplateEnd + 1 < pTemplateStart + numBytesCopied)
           && (originalLen - (pTemplateStart + numBytesCopied - pTemplateEnd - 1) < len))
       {
-        _cache.insert(_cache.begin(), &data[originalLen - (pTemplateStart + numBytesCopied - pTemplateEnd - 1)], &data[len]);
+        _cache.push_front(&data[originalLen - (pTemplateStart + numBytesCopied - pTemplateEnd - 1)],
+                          &data[len] - &data[originalLen - (pTemplateStart + numBytesCopied - pTemplateEnd - 1)]);
 
         //2. parameter value is longer than placeholder text, push the data after placeholder which not saved into cache further to the end
         memmove(pTemplateStart + numBytesCopied, pTemplateEnd + 1, &data[originalLen] - pTemplateStart - numBytesCopied);
@@ -993,7 +1334,10 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size
       // If result is longer than buffer, copy the remainder into cache (this could happen only if placeholder text itself did not fit entirely in buffer)
       if (numBytesCopied < pvlen)
       {
-        _cache.insert(_cache.begin(), pvstr + numBytesCopied, pvstr + pvlen);
+        _cache.push_front((const uint8_t*) pvstr + numBytesCopied, pvlen - numBytesCopied);
+
+        // The value fills the buffer, even when nothing followed the placeholder
+        len = originalLen;
       }
       else if (pTemplateStart + numBytesCopied < pTemplateEnd + 1)
       {
@@ -1009,6 +1353,9 @@ size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size
         const size_t roomTaken = pTemplateStart + numBytesCopied - pTemplateEnd - 1;
         len = std::min(len + roomTaken, originalLen);
       }
+
+      // Don't look for placeholders in the value
+      pTemplateStart += numBytesCopied;
     }
   } // while(pTemplateStart)
 
@@ -1030,52 +1377,139 @@ AsyncFileResponse::~AsyncFileResponse()
 
 /////////////////////////////////////////////////
 
+// Sorted by extension for the binary search in contentTypeFor()
+typedef struct
+{
+  const char* extension;
+  const char* contentType;
+} AsyncWebMimeType;
+
+static constexpr AsyncWebMimeType _mimeTypes[] =
+{
+  { "avif",        "image/avif" },
+  { "bin",         "application/octet-stream" },
+  { "css",         "text/css" },
+  { "csv",         "text/csv" },
+  { "eot",         "font/eot" },
+  { "gif",         "image/gif" },
+  { "gz",          "application/x-gzip" },
+  { "htm",         "text/html" },
+  { "html",        "text/html" },
+  { "ico",         "image/x-icon" },
+  { "jpeg",        "image/jpeg" },
+  { "jpg",         "image/jpeg" },
+  { "js",          "application/javascript" },
+  { "json",        "application/json" },
+  { "map",         "application/json" },
+  { "mjs",         "application/javascript" },
+  { "pdf",         "application/pdf" },
+  { "png",         "image/png" },
+  { "svg",         "image/svg+xml" },
+  { "ttf",         "font/ttf" },
+  { "txt",         "text/plain" },
+  { "wasm",        "application/wasm" },
+  { "webmanifest", "application/manifest+json" },
+  { "webp",        "image/webp" },
+  { "woff",        "font/woff" },
+  { "woff2",       "font/woff2" },
+  { "xml",         "text/xml" },
+  { "zip",         "application/zip" },
+};
+
+static constexpr size_t _mimeTypesCount = sizeof(_mimeTypes) / sizeof(_mimeTypes[0]);
+
+static constexpr bool _extensionLess(const char* a, const char* b)
+{
+  return (*a == *b) ? (*a && _extensionLess(a + 1, b + 1)) : (*a < *b);
+}
+
+static constexpr bool _mimeTypesSorted(size_t i = 1)
+{
+  return (i >= _mimeTypesCount) ||
+         (_extensionLess(_mimeTypes[i - 1].extension, _mimeTypes[i].extension) && _mimeTypesSorted(i + 1));
+}
+
+static_assert(_mimeTypesSorted(), "_mimeTypes must be sorted by extension");
+
+// Types added with AsyncWebServer::addMimeType(), looked up before the built-in table
+static std::vector<std::pair<String, String>> _customMimeTypes;
+
+/////////////////////////////////////////////////
+
+void AsyncFileResponse::addContentType(const String& extension, const String& contentType)
+{
+  String ext = extension.startsWith(".") ? extension.substring(1) : extension;
+
+  for (auto& mimeType : _customMimeTypes)
+  {
+    if (mimeType.first.equalsIgnoreCase(ext))
+    {
+      mimeType.second = contentType;
+
+      return;
+    }
+  }
+
+  _customMimeTypes.emplace_back(ext, contentType);
+}
+
+/////////////////////////////////////////////////
+
+const char* AsyncFileResponse::contentTypeFor(const String& path)
+{
+  const char* str = path.c_str();
+  const char* ext = strrchr(str, '.');
+
+  if (!ext || strchr(ext, '/'))
+    return "text/plain";
+
+  ext++;
+
+  for (const auto& mimeType : _customMimeTypes)
+  {
+    if (strcasecmp(mimeType.first.c_str(), ext) == 0)
+      return mimeType.second.c_str();
+  }
+
+  size_t lo = 0;
+  size_t hi = _mimeTypesCount;
+
+  while (lo < hi)
+  {
+    size_t mid = (lo + hi) / 2;
+    int cmp = strcasecmp(ext, _mimeTypes[mid].extension);
+
+    if (cmp == 0)
+      return _mimeTypes[mid].contentType;
+
+    if (cmp > 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return "text/plain";
+}
+
+/////////////////////////////////////////////////
+
 void AsyncFileResponse::_setContentType(const String& path)
 {
-  if      (path.endsWith(".html"))
-    _contentType = "text/html";
-  else if (path.endsWith(".htm"))
-    _contentType = "text/html";
-  else if (path.endsWith(".css"))
-    _contentType = "text/css";
-  else if (path.endsWith(".json"))
-    _contentType = "application/json";
-  else if (path.endsWith(".js"))
-    _contentType = "application/javascript";
-  else if (path.endsWith(".png"))
-    _contentType = "image/png";
-  else if (path.endsWith(".gif"))
-    _contentType = "image/gif";
-  else if (path.endsWith(".jpg"))
-    _contentType = "image/jpeg";
-  else if (path.endsWith(".ico"))
-    _contentType = "image/x-icon";
-  else if (path.endsWith(".svg"))
-    _contentType = "image/svg+xml";
-  else if (path.endsWith(".eot"))
-    _contentType = "font/eot";
-  else if (path.endsWith(".woff"))
-    _contentType = "font/woff";
-  else if (path.endsWith(".woff2"))
-    _contentType = "font/woff2";
-  else if (path.endsWith(".ttf"))
-    _contentType = "font/ttf";
-  else if (path.endsWith(".xml"))
-    _contentType = "text/xml";
-  else if (path.endsWith(".pdf"))
-    _contentType = "application/pdf";
-  else if (path.endsWith(".zip"))
-    _contentType = "application/zip";
-  else if (path.endsWith(".gz"))
-    _contentType = "application/x-gzip";
-  else
-    _contentType = "text/plain";
+  _contentType = contentTypeFor(path);
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebTemplate* AsyncFileResponse::_compileTemplate()
+{
+  return AsyncWebTemplate::fromFile(_content, _path);
 }
 
 /////////////////////////////////////////////////
 
 AsyncFileResponse::AsyncFileResponse(FS &fs, const String& path, const String& contentType, bool download,
                                      AwsTemplateProcessor callback): AsyncAbstractResponse(callback)
+  , _rangeCount(0), _rangeIndex(0), _rangeLeft(0), _rangePartSent(0)
 {
   _code = 200;
   _path = path;
@@ -1119,6 +1553,7 @@ AsyncFileResponse::AsyncFileResponse(FS &fs, const String& path, const String& c
 
 AsyncFileResponse::AsyncFileResponse(File content, const String& path, const String& contentType, bool download,
                                      AwsTemplateProcessor callback): AsyncAbstractResponse(callback)
+  , _rangeCount(0), _rangeIndex(0), _rangeLeft(0), _rangePartSent(0)
 {
   _code = 200;
   _path = path;
@@ -1155,9 +1590,275 @@ AsyncFileResponse::AsyncFileResponse(File content, const String& path, const Str
   addHeader("Content-Disposition", buf);
 }
 
+/////////////////////////////////////////////////
+
+// Parse "bytes=first-last, first-, -suffix" into _ranges (RFC 7233).
+// A malformed header or too many ranges is ignored, as allowed by the RFC, and the whole file is sent
+WebRangeResult AsyncFileResponse::_parseRange(const char* spec, size_t size)
+{
+  if (strncasecmp(spec, "bytes=", 6) != 0)
+    return RANGE_IGNORED;
+
+  const char* p = spec + 6;
+  uint8_t count = 0;
+  bool requested = false;
+
+  while (true)
+  {
+    while (*p == ' ' || *p == '\t')
+      p++;
+
+    bool hasFirst = false;
+    bool hasLast  = false;
+    size_t first  = 0;
+    size_t last   = 0;
+
+    while (*p >= '0' && *p <= '9')
+    {
+      if (first > (SIZE_MAX - 9) / 10)
+        return RANGE_IGNORED;
+
+      first = first * 10 + (*p++ - '0');
+      hasFirst = true;
+    }
+
+    if (*p++ != '-')
+      return RANGE_IGNORED;
+
+    while (*p >= '0' && *p <= '9')
+    {
+      if (last > (SIZE_MAX - 9) / 10)
+        return RANGE_IGNORED;
+
+      last = last * 10 + (*p++ - '0');
+      hasLast = true;
+    }
+
+    while (*p == ' ' || *p == '\t')
+      p++;
+
+    if ((*p != ',' && *p != 0) || (!hasFirst && !hasLast) || (hasFirst && hasLast && last < first))
+      return RANGE_IGNORED;
+
+    requested = true;
+
+    if (!hasFirst)
+    {
+      // Suffix range : the last "last" bytes
+      if (last && size)
+      {
+        first = (last > size) ? 0 : size - last;
+        last  = size - 1;
+        hasFirst = true;
+      }
+    }
+    else if (first < size)
+    {
+      if (!hasLast || last >= size)
+        last = size - 1;
+    }
+    else
+    {
+      hasFirst = false;
+    }
+
+    // Unsatisfiable ranges are skipped, 416 is only sent if none is left
+    if (hasFirst)
+    {
+      if (count == MAX_BYTE_RANGES)
+        return RANGE_IGNORED;
+
+      _ranges[count].first = first;
+      _ranges[count].last  = last;
+      count++;
+    }
+
+    if (*p == 0)
+      break;
+
+    p++;
+  }
+
+  if (!requested)
+    return RANGE_IGNORED;
+
+  _rangeCount = count;
+
+  return count ? RANGE_SATISFIABLE : RANGE_NOT_SATISFIABLE;
+}
+
+/////////////////////////////////////////////////
+
+// If-Range holds either the ETag or the Last-Modified date of the version the client already has
+bool AsyncFileResponse::_ifRangeMatches(const String& validator)
+{
+  for (const auto& header : _headers)
+  {
+    if ((header->name().equalsIgnoreCase("ETag") || header->name().equalsIgnoreCase("Last-Modified"))
+        && header->value() == validator)
+      return true;
+  }
+
+  return false;
+}
+
+/////////////////////////////////////////////////
+
+String AsyncFileResponse::_rangePartHead(uint8_t index, size_t size) const
+{
+  String head;
+
+  head.reserve(_rangeBoundary.length() + _rangeContentType.length() + 80);
+
+  head  = "\r\n--";
+  head += _rangeBoundary;
+  head += "\r\nContent-Type: ";
+  head += _rangeContentType;
+  head += "\r\nContent-Range: bytes ";
+  head += String(_ranges[index].first);
+  head += '-';
+  head += String(_ranges[index].last);
+  head += '/';
+  head += String(size);
+  head += "\r\n\r\n";
+
+  return head;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncFileResponse::_applyRange(AsyncWebServerRequest *request)
+{
+  // Templates change the length of the content, ranges can't be mapped to the file
+  if (_code != 200 || _callback || !_sendContentLength || !(request->method() & (HTTP_GET | HTTP_HEAD)))
+    return;
+
+  addHeader("Accept-Ranges", "bytes");
+
+  AsyncWebHeader* range = request->getHeader("Range");
+
+  if (!range)
+    return;
+
+  AsyncWebHeader* ifRange = request->getHeader("If-Range");
+
+  if (ifRange && !_ifRangeMatches(ifRange->value()))
+    return;
+
+  const size_t size = _contentLength;
+
+  switch (_parseRange(range->value().c_str(), size))
+  {
+    case RANGE_IGNORED:
+      return;
+
+    case RANGE_NOT_SATISFIABLE:
+      AWS_LOGDEBUG1("AsyncFileResponse: range not satisfiable, ", range->value());
+
+      _code = 416;
+      _contentLength = 0;
+      _contentType = String();
+      _rangeCount = 0;
+      addHeader("Content-Range", "bytes */" + String(size));
+
+      return;
+
+    default:
+      break;
+  }
+
+  _code = 206;
+
+  if (_rangeCount == 1)
+  {
+    _contentLength = _ranges[0].last - _ranges[0].first + 1;
+    addHeader("Content-Range", "bytes " + String(_ranges[0].first) + "-" + String(_ranges[0].last) + "/" + String(size));
+
+    return;
+  }
+
+  char boundary[20];
+
+  snprintf(boundary, sizeof(boundary), "%08lx%08lx", (unsigned long) micros(), (unsigned long) (uintptr_t) this);
+
+  _rangeBoundary    = boundary;
+  _rangeContentType = _contentType;
+  _contentType      = "multipart/byteranges; boundary=" + _rangeBoundary;
+
+  // Each part is its boundary and headers followed by the bytes, then the closing boundary
+  _contentLength = 8 + _rangeBoundary.length();
+
+  for (uint8_t i = 0; i < _rangeCount; i++)
+  {
+    _contentLength += _rangePartHead(i, size).length() + _ranges[i].last - _ranges[i].first + 1;
+  }
+}
+
+/////////////////////////////////////////////////
+
+void AsyncFileResponse::_respond(AsyncWebServerRequest *request)
+{
+  _applyRange(request);
+
+  AsyncAbstractResponse::_respond(request);
+}
+
+/////////////////////////////////////////////////
+
 size_t AsyncFileResponse::_fillBuffer(uint8_t *data, size_t len)
 {
-  return _content.read(data, len);
+  if (!_rangeCount)
+    return _content.read(data, len);
+
+  size_t filled = 0;
+
+  while (filled < len)
+  {
+    if (_rangePartSent < _rangePart.length())
+    {
+      size_t partLen = _rangePart.length() - _rangePartSent;
+
+      if (partLen > len - filled)
+        partLen = len - filled;
+
+      memcpy(data + filled, _rangePart.c_str() + _rangePartSent, partLen);
+      _rangePartSent += partLen;
+      filled += partLen;
+    }
+    else if (_rangeLeft)
+    {
+      const size_t readLen = _content.read(data + filled, (_rangeLeft > len - filled) ? len - filled : _rangeLeft);
+
+      if (readLen == 0)
+        break;
+
+      _rangeLeft -= readLen;
+      filled += readLen;
+    }
+    else if (_rangeIndex < _rangeCount)
+    {
+      // Start the next range
+      if (!_content.seek(_ranges[_rangeIndex].first, SeekSet))
+        break;
+
+      _rangeLeft = _ranges[_rangeIndex].last - _ranges[_rangeIndex].first + 1;
+      _rangePart = (_rangeCount > 1) ? _rangePartHead(_rangeIndex, _content.size()) : String();
+      _rangePartSent = 0;
+      _rangeIndex++;
+    }
+    else if (_rangeCount > 1 && _rangeIndex == _rangeCount)
+    {
+      _rangePart = "\r\n--" + _rangeBoundary + "--\r\n";
+      _rangePartSent = 0;
+      _rangeIndex++;
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  return filled;
 }
 
 /////////////////////////////////////////////////
@@ -1169,6 +1870,7 @@ size_t AsyncFileResponse::_fillBuffer(uint8_t *data, size_t len)
 
 AsyncStreamResponse::AsyncStreamResponse(Stream &stream, const String& contentType, size_t len,
                                          AwsTemplateProcessor callback): AsyncAbstractResponse(callback)
+  , _blockContent(nullptr)
 {
   _code = 200;
   _content = &stream;
@@ -1178,16 +1880,41 @@ AsyncStreamResponse::AsyncStreamResponse(Stream &stream, const String& contentTy
 
 /////////////////////////////////////////////////
 
+AsyncStreamResponse::AsyncStreamResponse(AsyncBlockStream &stream, const String& contentType, size_t len,
+                                         AwsTemplateProcessor callback)
+  : AsyncStreamResponse((Stream &) stream, contentType, len, callback)
+{
+  _blockContent = &stream;
+}
+
+/////////////////////////////////////////////////
+
 size_t AsyncStreamResponse::_fillBuffer(uint8_t *data, size_t len)
 {
-  size_t available = _content->available();
-  size_t outLen = (available > len) ? len : available;
+  int available = _content->available();
+
+  if (available <= 0)
+    return 0;
+
+  size_t outLen = ((size_t) available > len) ? len : available;
+
+  if (_blockContent)
+    return _blockContent->readBlock(data, outLen);
+
+  // Stream::readBytes() would be no faster, it also reads byte by byte, and it waits for its timeout on a short read
   size_t i;
 
   for (i = 0; i < outLen; i++)
-    data[i] = _content->read();
+  {
+    int c = _content->read();
+
+    if (c < 0)
+      break;
+
+    data[i] = c;
+  }
 
-  return outLen;
+  return i;
 }
 
 /////////////////////////////////////////////////
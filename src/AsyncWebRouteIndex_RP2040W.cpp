@@ -0,0 +1,278 @@
+/****************************************************************************************************************************
+  AsyncWebRouteIndex_RP2040W.cpp
+
+  For RP2040W with CYW43439 WiFi
+
+  AsyncWebServer_RP2040W is a library for the RP2040W with CYW43439 WiFi
+
+  Based on and modified from ESPAsyncWebServer (https://github.com/me-no-dev/ESPAsyncWebServer)
+  Built by Khoi Hoang https://github.com/khoih-prog/AsyncWebServer_RP2040W
+  Licensed under GPLv3 license
+
+  Version: 1.5.0
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      13/08/2022 Initial coding for RP2040W with CYW43439 WiFi
+  ...
+  1.3.0   K Hoang      10/10/2022 Fix crash when using AsyncWebSockets server
+  1.3.1   K Hoang      10/10/2022 Improve robustness of AsyncWebSockets server
+  1.4.0   K Hoang      20/10/2022 Add LittleFS functions such as AsyncFSWebServer
+  1.4.1   K Hoang      10/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.4.2   K Hoang      28/01/2023 Add Async_AdvancedWebServer_SendChunked_MQTT and AsyncWebServer_MQTT_RP2040W examples
+  1.5.0   K Hoang      30/01/2023 Fix _catchAllHandler not working bug
+ *****************************************************************************************************************************/
+
+#if !defined(_RP2040W_AWS_LOGLEVEL_)
+  #define _RP2040W_AWS_LOGLEVEL_     1
+#endif
+
+/////////////////////////////////////////////////
+
+#include "AsyncWebServer_RP2040W_Debug.h"
+
+#include "AsyncWebServer_RP2040W.h"
+
+#include <algorithm>
+
+/////////////////////////////////////////////////
+
+static int compareSegment(const String& segment, const char* str, size_t len)
+{
+  int cmp = strncmp(segment.c_str(), str, len);
+
+  if (cmp == 0 && segment.length() != len)
+    cmp = (segment.length() < len) ? -1 : 1;
+
+  return cmp;
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebRouteIndex::Node::~Node()
+{
+  for (const auto& c : children)
+    delete c;
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebRouteIndex::Node* AsyncWebRouteIndex::Node::child(const char* str, size_t len) const
+{
+  auto it = std::lower_bound(children.begin(), children.end(), len, [str](const Node * n, size_t l)
+  {
+    return compareSegment(n->segment, str, l) < 0;
+  });
+
+  if (it != children.end() && compareSegment((*it)->segment, str, len) == 0)
+    return *it;
+
+  return NULL;
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebRouteIndex::Node* AsyncWebRouteIndex::Node::addChild(const char* str, size_t len)
+{
+  auto it = std::lower_bound(children.begin(), children.end(), len, [str](const Node * n, size_t l)
+  {
+    return compareSegment(n->segment, str, l) < 0;
+  });
+
+  if (it != children.end() && compareSegment((*it)->segment, str, len) == 0)
+    return *it;
+
+  Node* n = new Node();
+
+  n->segment.concat(str, len);
+
+  return *children.insert(it, n);
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebRouteIndex::~AsyncWebRouteIndex()
+{
+  clear();
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRouteIndex::clear()
+{
+  if (_root)
+  {
+    delete _root;
+    _root = NULL;
+  }
+
+  _entries.clear();
+  _always.clear();
+  _extensions.clear();
+  _candidates.clear();
+  _valid = false;
+}
+
+/////////////////////////////////////////////////
+
+// Walk / create the trie nodes for the '/' separated segments, and attach the entry to the last one
+void AsyncWebRouteIndex::_add(uint16_t index, const char* segments, size_t len)
+{
+  Node* node = _root;
+  const char* end = segments + len;
+
+  while (segments)
+  {
+    const char* slash = (const char*) memchr(segments, '/', end - segments);
+    const char* segEnd = slash ? slash : end;
+
+    node = node->addChild(segments, segEnd - segments);
+    segments = slash ? slash + 1 : NULL;
+  }
+
+  node->entries.push_back(index);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRouteIndex::build(LinkedList<AsyncWebHandler*>& handlers)
+{
+  clear();
+
+  _root = new Node();
+  _entries.reserve(handlers.length());
+
+  for (const auto& h : handlers)
+  {
+    Entry e;
+
+    e.handler = h;
+    e.methods = HTTP_ANY;
+    e.type = h->route(e.partial, e.methods);
+
+    const uint16_t index = _entries.size();
+    const String& pattern = e.partial;
+
+    if ( (e.type == ROUTE_PREFIX) && (pattern.length() == 0) )
+    {
+      // Matches every url
+      _always.push_back(index);
+    }
+    else if (e.type == ROUTE_EXTENSION)
+    {
+      // canHandle() uses url.endsWith(".ext"), same as comparing from the last '.' of the url
+      _extensions.push_back(index);
+    }
+    else if ( (e.type == ROUTE_CUSTOM) || !pattern.startsWith("/") )
+    {
+      e.type = ROUTE_CUSTOM;
+      e.methods = HTTP_ANY;
+      _always.push_back(index);
+    }
+    else if (e.type == ROUTE_PREFIX)
+    {
+      // "/a/b/pre" => segments "a" then "b", "pre" has to start the next url segment
+      const int lastSlash = pattern.lastIndexOf('/');
+
+      if (lastSlash == 0)
+        _root->entries.push_back(index);
+      else
+        _add(index, pattern.c_str() + 1, lastSlash - 1);
+
+      e.partial = pattern.substring(lastSlash + 1);
+    }
+    else
+    {
+      // ROUTE_EXACT / ROUTE_PATH : "/a/b" => segments "a" then "b", "/" => one empty segment
+      _add(index, pattern.c_str() + 1, pattern.length() - 1);
+      e.partial = String();
+    }
+
+    _entries.push_back(e);
+  }
+
+  _candidates.reserve(_entries.size());
+  _valid = true;
+
+  AWS_LOGDEBUG1("AsyncWebRouteIndex::build: routes =", _entries.size());
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebHandler* AsyncWebRouteIndex::find(AsyncWebServerRequest *request)
+{
+  const WebRequestMethodComposite method = request->method();
+  const char* url = request->url().c_str();
+
+  _candidates.clear();
+
+  for (const auto& i : _always)
+  {
+    if (_entries[i].methods & method)
+      _candidates.push_back(i);
+  }
+
+  const char* dot = strrchr(url, '.');
+
+  if (dot)
+  {
+    for (const auto& i : _extensions)
+    {
+      if ( (_entries[i].methods & method) && (strcmp(dot, _entries[i].partial.c_str()) == 0) )
+        _candidates.push_back(i);
+    }
+  }
+
+  if (url[0] == '/' && _root)
+  {
+    const Node* node = _root;
+    const char* pos = url;
+
+    while (true)
+    {
+      // Url segments matched so far are exactly the segments of this node
+      for (const auto& i : node->entries)
+      {
+        const Entry& e = _entries[i];
+
+        if ( !(e.methods & method) )
+          continue;
+
+        if ( (e.type == ROUTE_PATH) || ((e.type == ROUTE_EXACT) && (*pos == 0))
+             || ((e.type == ROUTE_PREFIX) && (*pos == '/') && !strncmp(pos + 1, e.partial.c_str(), e.partial.length())) )
+        {
+          _candidates.push_back(i);
+        }
+      }
+
+      if (*pos == 0)
+        break;
+
+      const char* segment = pos + 1;
+      const char* segEnd = strchr(segment, '/');
+
+      if (!segEnd)
+        segEnd = segment + strlen(segment);
+
+      node = node->child(segment, segEnd - segment);
+
+      if (!node)
+        break;
+
+      pos = segEnd;
+    }
+  }
+
+  // First added handler wins, as with the linear scan
+  std::sort(_candidates.begin(), _candidates.end());
+
+  for (const auto& i : _candidates)
+  {
+    AsyncWebHandler* h = _entries[i].handler;
+
+    if (h->filter(request) && h->canHandle(request))
+      return h;
+  }
+
+  return NULL;
+}
@@ -34,6 +34,8 @@
 #include "AsyncWebServer_RP2040W.h"
 #include "AsyncWebHandlerImpl_RP2040W.h"
 
+#include <malloc.h>
+
 /////////////////////////////////////////////////
 
 bool ON_STA_FILTER(AsyncWebServerRequest *request) 
@@ -59,7 +61,13 @@ AsyncWebServer::AsyncWebServer(uint16_t port)
 {
   delete h;
 }))
+, _keepAlive(false), _keepAliveTimeout(DEFAULT_KEEP_ALIVE_TIMEOUT), _keepAliveMaxRequests(DEFAULT_KEEP_ALIVE_MAX_REQUESTS)
+, _heapStats(false)
+, _requestPoolSize(DEFAULT_REQUEST_POOL_SIZE), _requestPoolCount(0), _requestPoolPolicy(REQUEST_POOL_ALLOCATE)
 {
+  resetMemoryStats();
+  memset(&_poolStats, 0, sizeof(_poolStats));
+
   _catchAllHandler = new AsyncCallbackWebHandler();
 
   if (_catchAllHandler == NULL)
@@ -79,14 +87,7 @@ AsyncWebServer::AsyncWebServer(uint16_t port)
     c->setRxTimeout(0);
     //////
 
-    AsyncWebServerRequest *r = new AsyncWebServerRequest((AsyncWebServer*)s, c);
-
-    if (r == NULL)
-    {
-      c->close(true);
-      c->free();
-      delete c;
-    }
+    ((AsyncWebServer*)s)->_acquireRequest(c);
   }, this);
 }
 
@@ -99,6 +100,99 @@ AsyncWebServer::~AsyncWebServer()
 
   if (_catchAllHandler)
     delete _catchAllHandler;
+
+  setRequestPool(0);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServer::setRequestPool(uint16_t size, RequestPoolPolicy policy)
+{
+  _requestPoolSize    = size;
+  _requestPoolPolicy  = policy;
+
+  // Shrink : pooled requests in use are deleted when their connection closes
+  while (_idleRequests.size() > size)
+  {
+    delete _idleRequests.back();
+    _idleRequests.pop_back();
+    _requestPoolCount--;
+  }
+
+  _idleRequests.reserve(size);
+  _poolStats.idle = _idleRequests.size();
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebServerRequest* AsyncWebServer::_acquireRequest(AsyncClient* c)
+{
+  AsyncWebServerRequest *r = NULL;
+
+  if (!_idleRequests.empty())
+  {
+    r = _idleRequests.back();
+    _idleRequests.pop_back();
+    r->_attach(c);
+
+    _poolStats.hits++;
+  }
+  else if (_requestPoolCount < _requestPoolSize)
+  {
+    r = new AsyncWebServerRequest(this, c);
+
+    if (r)
+    {
+      r->_pooled = true;
+      _requestPoolCount++;
+    }
+
+    _poolStats.misses++;
+  }
+  else if (_requestPoolSize && (_requestPoolPolicy == REQUEST_POOL_REJECT))
+  {
+    // Fail fast, without allocating a request
+    static const char response[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nRetry-After: 1\r\nConnection: close\r\n\r\n";
+
+    AWS_LOGDEBUG("_acquireRequest: pool exhausted, 503");
+
+    c->onDisconnect([](void *r, AsyncClient * c)
+    {
+      RP2040W_AWS_UNUSED(r);
+      delete c;
+    }, NULL);
+
+    c->write(response, sizeof(response) - 1);
+    c->close();
+
+    _poolStats.rejected++;
+
+    return NULL;
+  }
+  else
+  {
+    r = new AsyncWebServerRequest(this, c);
+
+    // Without a pool there is nothing to miss
+    if (_requestPoolSize)
+      _poolStats.misses++;
+  }
+
+  if (r == NULL)
+  {
+    c->close(true);
+    c->free();
+    delete c;
+
+    return NULL;
+  }
+
+  if (r->_pooled)
+    _poolStats.inUse++;
+
+  _poolStats.idle = _idleRequests.size();
+
+  return r;
 }
 
 /////////////////////////////////////////////////
@@ -129,6 +223,7 @@ AsyncWebRewrite& AsyncWebServer::rewrite(const char* from, const char* to)
 AsyncWebHandler& AsyncWebServer::addHandler(AsyncWebHandler* handler)
 {
   _handlers.add(handler);
+  _routes.invalidate();
 
   return *handler;
 }
@@ -137,6 +232,8 @@ AsyncWebHandler& AsyncWebServer::addHandler(AsyncWebHandler* handler)
 
 bool AsyncWebServer::removeHandler(AsyncWebHandler *handler)
 {
+  _routes.invalidate();
+
   return _handlers.remove(handler);
 }
 
@@ -175,6 +272,23 @@ void AsyncWebServer::beginSecure(const char *cert, const char *key, const char *
 
 void AsyncWebServer::_handleDisconnect(AsyncWebServerRequest *request)
 {
+  if (request->_pooled)
+  {
+    _poolStats.inUse--;
+
+    if (_idleRequests.size() < _requestPoolSize)
+    {
+      // Keep it, with its arena block and String buffers, for the next connection
+      request->_detach();
+      _idleRequests.push_back(request);
+      _poolStats.idle = _idleRequests.size();
+
+      return;
+    }
+
+    _requestPoolCount--;
+  }
+
   delete request;
 }
 
@@ -194,16 +308,41 @@ void AsyncWebServer::_rewriteRequest(AsyncWebServerRequest *request)
 
 /////////////////////////////////////////////////
 
+void AsyncWebServer::_updateMemoryStats(const AsyncWebArena& arena)
+{
+  _memoryStats.requests++;
+
+  if (arena.blocks() > 1)
+    _memoryStats.arenaOverflows++;
+
+  if (arena.used() > _memoryStats.arenaPeak)
+    _memoryStats.arenaPeak = arena.used();
+
+  if (!_heapStats)
+    return;
+
+  struct mallinfo mi = mallinfo();
+
+  if ((size_t) mi.uordblks > _memoryStats.heapPeak)
+    _memoryStats.heapPeak = mi.uordblks;
+
+  _memoryStats.heapFreeChunks = mi.ordblks;
+}
+
+/////////////////////////////////////////////////
+
 void AsyncWebServer::_attachHandler(AsyncWebServerRequest *request)
 {
-  for (const auto& h : _handlers)
+  if (!_routes.valid())
+    _routes.build(_handlers);
+
+  AsyncWebHandler* h = _routes.find(request);
+
+  if (h)
   {
-    if (h->filter(request) && h->canHandle(request))
-    {
-      request->setHandler(h);
+    request->setHandler(h);
 
-      return;
-    }
+    return;
   }
 
   request->addInterestingHeader("ANY");
@@ -310,10 +449,18 @@ void AsyncWebServer::onRequestBody(ArBodyHandlerFunction fn)
 
 /////////////////////////////////////////////////
 
+void AsyncWebServer::addMimeType(const String& extension, const String& contentType)
+{
+  AsyncFileResponse::addContentType(extension, contentType);
+}
+
+/////////////////////////////////////////////////
+
 void AsyncWebServer::reset()
 {
   _rewrites.free();
   _handlers.free();
+  _routes.clear();
 
   if (_catchAllHandler != NULL)
   {
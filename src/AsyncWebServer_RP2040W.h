@@ -54,11 +54,15 @@
 
 #include "Arduino.h"
 #include <functional>
+#include <vector>
 
 #include <AsyncTCP_RP2040W.h>
 
 #include "AsyncWebServer_RP2040W_Debug.h"
 #include "StringArray_RP2040W.h"
+#include "AsyncWebArena_RP2040W.h"
+#include "AsyncWebSharedBuffer_RP2040W.h"
+#include "AsyncWebUploadSink_RP2040W.h"
 
 #ifdef ASYNCWEBSERVER_REGEX
   #warning Using ASYNCWEBSERVER_REGEX
@@ -103,16 +107,52 @@ typedef enum
 //if this value is returned when asked for data, packet will not be sent and you will be asked for data again
 #define RESPONSE_TRY_AGAIN 0xFFFFFFFF
 
+// HTTP/1.1 persistent connections. Disabled by default, enable with AsyncWebServer::setKeepAlive(true)
+// Idle timeout in seconds before an idle persistent connection is closed
+#ifndef DEFAULT_KEEP_ALIVE_TIMEOUT
+  #define DEFAULT_KEEP_ALIVE_TIMEOUT          5
+#endif
+
+// Max requests served over one persistent connection. 0 => unlimited
+#ifndef DEFAULT_KEEP_ALIVE_MAX_REQUESTS
+  #define DEFAULT_KEEP_ALIVE_MAX_REQUESTS     100
+#endif
+
+// Max bytes of pipelined requests buffered while the current response is still being sent
+#ifndef KEEP_ALIVE_MAX_PIPELINED_LENGTH
+  #define KEEP_ALIVE_MAX_PIPELINED_LENGTH     2048
+#endif
+
+// Empty lines ignored before the next request line on a persistent connection, RFC 9112 2.2
+#ifndef KEEP_ALIVE_MAX_EMPTY_LINES
+  #define KEEP_ALIVE_MAX_EMPTY_LINES          4
+#endif
+
+// Request objects kept for reuse by new connections. 0 => no pool, new / delete for every connection
+#ifndef DEFAULT_REQUEST_POOL_SIZE
+  #define DEFAULT_REQUEST_POOL_SIZE           0
+#endif
+
 typedef uint8_t WebRequestMethodComposite;
 typedef std::function<void()> ArDisconnectHandler;
 
+// How a handler matches the request url, lets AsyncWebServer index its handlers
+typedef enum
+{
+  ROUTE_CUSTOM,       // only canHandle() knows, always checked
+  ROUTE_EXACT,        // url == pattern
+  ROUTE_PATH,         // url == pattern or url starts with pattern + "/"
+  ROUTE_PREFIX,       // url starts with pattern
+  ROUTE_EXTENSION     // url ends with pattern (".ext")
+} WebRouteType;
+
 /////////////////////////////////////////////////
 
 /*
    PARAMETER :: Chainable object to hold GET/POST and FILE parameters
  * */
 
-class AsyncWebParameter
+class AsyncWebParameter : public LinkedListHook<AsyncWebParameter>
 {
   private:
     String _name;
@@ -171,7 +211,7 @@ class AsyncWebParameter
    HEADER :: Chainable object to hold the headers
  * */
 
-class AsyncWebHeader
+class AsyncWebHeader : public LinkedListHook<AsyncWebHeader>
 {
   private:
     String _name;
@@ -244,6 +284,16 @@ typedef enum
 typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
 typedef std::function<String(const String&)> AwsTemplateProcessor;
 
+/////////////////////////////////////////////////////////
+
+// Stream that can copy many bytes per call, for example one backed by a contiguous buffer.
+// AsyncStreamResponse then reads it with readBlock() instead of one read() per byte.
+class AsyncBlockStream : public Stream
+{
+  public:
+    // Copy up to len bytes to buf, without blocking, and return how many were copied
+    virtual size_t readBlock(uint8_t *buf, size_t len) = 0;
+};
 
 /////////////////////////////////////////////////////////
 
@@ -252,6 +302,9 @@ class AsyncWebServerRequest
 {
     friend class AsyncWebServer;
     friend class AsyncCallbackWebHandler;
+    friend class AsyncWebServerResponse;
+    friend class AsyncWebSocketClient;
+    friend class AsyncEventSourceClient;
 
   private:
     AsyncClient* _client;
@@ -281,46 +334,104 @@ class AsyncWebServerRequest
     bool      _isMultipart;
     bool      _isPlainPost;
     bool      _expectingContinue;
+    bool      _hasContentLength;
+    bool      _badRequest;          // answered with 400 once the headers are read
     size_t    _contentLength;
     size_t    _parsedLength;
 
-    LinkedList<AsyncWebHeader *> _headers;
-    LinkedList<AsyncWebParameter *> _params;
+    // Persistent connection (keep-alive) state
+    bool      _keepAlive;
+    bool      _connectionClose;
+    bool      _connectionKeepAlive;
+    bool      _transferEncoding;    // body framing we can't parse, don't reuse the connection
+    uint16_t  _requestCount;
+    uint8_t   _emptyLines;
+    uint8_t*  _pipelineBuffer;
+    size_t    _pipelineLength;
+
+    // Request scoped headers, params and path params
+    mutable AsyncWebArena _arena;
+
+    // Received headers, kept in the arena until something reads them
+    struct RawHeader
+    {
+      RawHeader*  next;
+      char*       name;
+      char*       value;
+    };
+
+    mutable RawHeader* _rawHeaders;
+    mutable RawHeader* _rawHeadersTail;
+    bool      _headersFiltered;
+
+    mutable IntrusiveLinkedList<AsyncWebHeader> _headers;
+    mutable IntrusiveLinkedList<AsyncWebParameter> _params;
+    // Query string(s), not decoded, until something reads the params
+    mutable String _rawQuery;
     LinkedList<String *> _pathParams;
 
     uint8_t   _multiParseState;
-    uint8_t   _boundaryPosition;
+    size_t    _boundaryPosition;  // bytes of "\r\n--boundary" matched at the end of the last data received
     size_t    _itemStartIndex;
     size_t    _itemSize;
     String    _itemName;
     String    _itemFilename;
     String    _itemType;
     String    _itemValue;
-    uint8_t*  _itemBuffer;
-    size_t    _itemBufferIndex;
     bool      _itemIsFile;
 
+    // Upload data queued for a writer, with its TCP window held back until it is written
+    AsyncWebUploadSink* _uploadSink;
+    bool      _uploadSinkActive;      // the sink takes the data of the current file
+    bool      _uploadRequestPending;  // body received, handleRequest() waits for the sink
+    size_t    _uploadUnacked;         // received bytes not acked to TCP yet
+
+    bool      _pooled;          // owned by the server's request pool
+
     void _onPoll();
     void _onAck(size_t len, uint32_t time);
     void _onError(int8_t error);
     void _onTimeout(uint32_t time);
     void _onDisconnect();
     void _onData(void *buf, size_t len);
+    void _parseData(void *buf, size_t len, size_t received);
 
     void _addParam(AsyncWebParameter*);
     void _addPathParam(const char *param);
 
-    bool _parseReqHead();
-    bool _parseReqHeader();
-    void _parseLine();
+    bool _parseReqHead(const char *line, size_t len);
+    bool _parseReqHeader(const char *line, size_t len);
+    void _parseHeaders() const;
+    void _parseParams() const;
+    void _parseLine(const char *line, size_t len);
     void _parsePlainPostChar(uint8_t data);
-    void _parseMultipartPostByte(uint8_t data, bool last);
-    void _addGetParams(const String& params);
+    void _parseMultipartPost(uint8_t *data, size_t len);
+    void _parseMultipartHeader();
+    void _addGetParams(const char *params, size_t len);
+
+    /////////////////////////////////////////////////
+
+    inline void _addGetParams(const String& params)
+    {
+      _addGetParams(params.c_str(), params.length());
+    }
 
     void _handleUploadStart();
-    void _handleUploadByte(uint8_t data, bool last);
+    void _itemWrite(uint8_t *data, size_t len, bool final);
+    void _itemEnd();
+    void _uploadPush(uint8_t *data, size_t len);
+    void _uploadFlush(size_t received = 0);
+    void _handleRequest();
     void _handleUploadEnd();
 
+    bool _bufferPipelined(const uint8_t *data, size_t len);
+    void _checkKeepAlive(bool keepAlive);
+    void _recycle();
+
+    void _attach(AsyncClient* c);
+    void _detach();
+    void _reset();
+
   public:
     File _tempFile;
     void *_tempObject;
@@ -386,6 +497,30 @@ class AsyncWebServerRequest
 
     /////////////////////////////////////////////////
 
+    // From the upload handler : the rest of the file being uploaded, this call's data included, goes to writer
+    // in blockSize writes instead of to the upload handler. See README "Upload sink"
+    void setUploadSink(AwsUploadSinkWriter writer, AwsUploadSinkEnd onEnd = nullptr,
+                       size_t blockSize = UPLOAD_SINK_BLOCK_SIZE);
+    // Same, written to file, closed at the end
+    void setUploadSink(File file, AwsUploadSinkEnd onEnd = nullptr);
+
+    /////////////////////////////////////////////////
+
+    inline AsyncWebUploadSink* uploadSink() const
+    {
+      return _uploadSink;
+    }
+
+    /////////////////////////////////////////////////
+
+    // true if the connection is kept open for another request after this one
+    inline bool keepAlive() const
+    {
+      return _keepAlive;
+    }
+
+    /////////////////////////////////////////////////
+
     const char * methodToString() const;
     const char * requestedConnTypeToString() const;
 
@@ -442,6 +577,7 @@ class AsyncWebServerRequest
               AwsTemplateProcessor callback = nullptr);
 
     void send(Stream &stream, const String& contentType, size_t len, AwsTemplateProcessor callback = nullptr);
+    void send(AsyncBlockStream &stream, const String& contentType, size_t len, AwsTemplateProcessor callback = nullptr);
     void send(const String& contentType, size_t len, AwsResponseFiller callback,
               AwsTemplateProcessor templateCallback = nullptr);
     void sendChunked(const String& contentType, AwsResponseFiller callback,
@@ -459,6 +595,8 @@ class AsyncWebServerRequest
                                           AwsTemplateProcessor callback = nullptr);
     AsyncWebServerResponse *beginResponse(Stream &stream, const String& contentType, size_t len,
                                           AwsTemplateProcessor callback = nullptr);
+    AsyncWebServerResponse *beginResponse(AsyncBlockStream &stream, const String& contentType, size_t len,
+                                          AwsTemplateProcessor callback = nullptr);
     AsyncWebServerResponse *beginResponse(const String& contentType, size_t len, AwsResponseFiller callback,
                                           AwsTemplateProcessor templateCallback = nullptr);
     AsyncWebServerResponse *beginChunkedResponse(const String& contentType, AwsResponseFiller callback,
@@ -501,7 +639,7 @@ class AsyncWebServerRequest
     bool hasArg(const char* name) const;                          // check if argument exists
     bool hasArg(const __FlashStringHelper * data) const;          // check if F(argument) exists
 
-    const String& ASYNCWEBSERVER_REGEX_ATTRIBUTE pathArg(size_t i) const;
+    const String& pathArg(size_t i) const;                        // get path param ("/api/{id}" or regex route) by number
 
     const String& header(const char* name) const;                 // get request header value by name
     const String& header(const __FlashStringHelper * data) const; // get request header value by F(name)
@@ -669,6 +807,16 @@ class AsyncWebHandler
     {
       return true;
     }
+
+    /////////////////////////////////////////////////
+
+    // Urls and methods this handler can match, read when the server (re)builds its route index.
+    // canHandle() is still called on the matching handlers
+    virtual WebRouteType route(String& pattern __attribute__((unused)),
+                               WebRequestMethodComposite& methods __attribute__((unused)))
+    {
+      return ROUTE_CUSTOM;
+    }
 };
 
 /////////////////////////////////////////////////
@@ -686,7 +834,7 @@ class AsyncWebServerResponse
 {
   protected:
     int _code;
-    LinkedList<AsyncWebHeader *> _headers;
+    IntrusiveLinkedList<AsyncWebHeader> _headers;
     String _contentType;
     size_t _contentLength;
     bool _sendContentLength;
@@ -696,7 +844,10 @@ class AsyncWebServerResponse
     size_t _ackedLength;
     size_t _writtenLength;
     WebResponseState _state;
+    bool _connectionKeepAlive;
     const char* _responseCodeToString(int code);
+    bool _hasHeader(const String& name);
+    void _addConnectionHeader(AsyncWebServerRequest *request);
 
   public:
     AsyncWebServerResponse();
@@ -710,6 +861,16 @@ class AsyncWebServerResponse
     virtual bool _finished() const;
     virtual bool _failed() const;
     virtual bool _sourceValid() const;
+
+    /////////////////////////////////////////////////
+
+    inline bool _keepAlive() const
+    {
+      return _connectionKeepAlive;
+    }
+
+    /////////////////////////////////////////////////
+
     virtual void _respond(AsyncWebServerRequest *request);
     virtual size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
 };
@@ -728,6 +889,102 @@ ArBodyHandlerFunction;
 
 /////////////////////////////////////////////////
 
+/*
+   ROUTE INDEX :: Finds the handlers which can match a request without asking all of them.
+   Exact, path and prefix routes live in a trie of url segments, extension routes in a table,
+   custom handlers are always candidates. Candidates are tried in the order they were added
+ * */
+
+class AsyncWebRouteIndex
+{
+  private:
+    struct Entry
+    {
+      AsyncWebHandler* handler;
+      WebRequestMethodComposite methods;
+      WebRouteType type;
+      String partial;                 // prefix : part after the last '/', extension : ".ext"
+    };
+
+    struct Node
+    {
+      String segment;
+      std::vector<Node*> children;    // sorted by segment
+      std::vector<uint16_t> entries;
+
+      Node() {}
+      ~Node();
+
+      Node* child(const char* segment, size_t len) const;
+      Node* addChild(const char* segment, size_t len);
+    };
+
+    std::vector<Entry> _entries;
+    Node* _root;
+    std::vector<uint16_t> _always;
+    std::vector<uint16_t> _extensions;
+    std::vector<uint16_t> _candidates;
+    bool _valid;
+
+    void _add(uint16_t index, const char* segments, size_t len);
+
+  public:
+    AsyncWebRouteIndex() : _root(NULL), _valid(false) {}
+    ~AsyncWebRouteIndex();
+
+    /////////////////////////////////////////////////
+
+    inline bool valid() const
+    {
+      return _valid;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline void invalidate()
+    {
+      _valid = false;
+    }
+
+    /////////////////////////////////////////////////
+
+    void clear();
+    void build(LinkedList<AsyncWebHandler*>& handlers);
+    AsyncWebHandler* find(AsyncWebServerRequest *request);
+};
+
+/////////////////////////////////////////////////
+
+// Heap use of the requests, see AsyncWebServer::memoryStats()
+typedef struct
+{
+  uint32_t requests;          // requests finished
+  uint32_t arenaOverflows;    // requests which needed more than one arena block
+  size_t   arenaPeak;         // most arena bytes used by one request
+  size_t   heapPeak;          // most heap in use, sampled when a request ends, see enableMemoryStats()
+  size_t   heapFreeChunks;    // free heap chunks at the last sample, grows with fragmentation
+} AsyncWebMemoryStats;
+
+/////////////////////////////////////////////////
+
+// What to do with a new connection when all pooled requests are in use
+typedef enum
+{
+  REQUEST_POOL_ALLOCATE,      // allocate an extra request, deleted when its connection closes
+  REQUEST_POOL_REJECT         // answer "503 Service Unavailable" and close
+} RequestPoolPolicy;
+
+typedef struct
+{
+  uint32_t hits;              // connections served by an idle pooled request
+  uint32_t misses;            // connections which needed a new request
+  uint32_t rejected;          // connections refused with 503
+  uint16_t inUse;             // pooled requests serving a connection
+  uint16_t idle;              // pooled requests waiting for a connection
+} AsyncWebPoolStats;
+
+/////////////////////////////////////////////////
+
 class AsyncWebServer
 {
   protected:
@@ -735,6 +992,22 @@ class AsyncWebServer
     LinkedList<AsyncWebRewrite*> _rewrites;
     LinkedList<AsyncWebHandler*> _handlers;
     AsyncCallbackWebHandler* _catchAllHandler;
+    AsyncWebRouteIndex _routes;
+
+    bool     _keepAlive;
+    uint16_t _keepAliveTimeout;
+    uint16_t _keepAliveMaxRequests;
+
+    AsyncWebMemoryStats _memoryStats;
+    bool                _heapStats;
+
+    std::vector<AsyncWebServerRequest*> _idleRequests;
+    uint16_t          _requestPoolSize;
+    uint16_t          _requestPoolCount;      // pooled requests alive, idle or in use
+    RequestPoolPolicy _requestPoolPolicy;
+    AsyncWebPoolStats _poolStats;
+
+    AsyncWebServerRequest* _acquireRequest(AsyncClient* c);
 
   public:
     AsyncWebServer(uint16_t port);
@@ -743,6 +1016,93 @@ class AsyncWebServer
     void begin();
     void end();
 
+    /////////////////////////////////////////////////
+
+    // Keep connections open after a response (HTTP/1.1 persistent connections and request pipelining)
+    inline void setKeepAlive(bool enable)
+    {
+      _keepAlive = enable;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline bool keepAlive() const
+    {
+      return _keepAlive;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Idle time in seconds before a persistent connection is closed
+    inline void setKeepAliveTimeout(uint16_t seconds)
+    {
+      _keepAliveTimeout = seconds;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline uint16_t keepAliveTimeout() const
+    {
+      return _keepAliveTimeout;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Max requests served over one persistent connection, 0 => unlimited
+    inline void setKeepAliveMaxRequests(uint16_t maxRequests)
+    {
+      _keepAliveMaxRequests = maxRequests;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline uint16_t keepAliveMaxRequests() const
+    {
+      return _keepAliveMaxRequests;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline const AsyncWebMemoryStats& memoryStats() const
+    {
+      return _memoryStats;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline void resetMemoryStats()
+    {
+      memset(&_memoryStats, 0, sizeof(_memoryStats));
+    }
+
+    /////////////////////////////////////////////////
+
+    // Heap peak and free chunks in memoryStats(). Off by default : mallinfo() walks the free heap at the end of each request
+    inline void enableMemoryStats(bool enable = true)
+    {
+      _heapStats = enable;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Content type served for files with this extension, e.g. addMimeType("md", "text/markdown").
+    // Call before begin(), static handlers cache the content type of the files they served.
+    void addMimeType(const String& extension, const String& contentType);
+
+    /////////////////////////////////////////////////
+
+    // Max request objects kept for reuse, and what to do when they are all in use
+    void setRequestPool(uint16_t size, RequestPoolPolicy policy = REQUEST_POOL_ALLOCATE);
+
+    /////////////////////////////////////////////////
+
+    inline const AsyncWebPoolStats& poolStats() const
+    {
+      return _poolStats;
+    }
+
+    /////////////////////////////////////////////////
+
 #if ASYNC_TCP_SSL_ENABLED
     //void onSslFileRequest(AcSSlFileHandler cb, void* arg);
     //void beginSecure(const char *cert, const char *private_key_file, const char *password);
@@ -777,6 +1137,7 @@ class AsyncWebServer
     void reset(); //remove all writers and handlers, with onNotFound/onFileUpload/onRequestBody
 
     void _handleDisconnect(AsyncWebServerRequest *request);
+    void _updateMemoryStats(const AsyncWebArena& arena);
     void _attachHandler(AsyncWebServerRequest *request);
     void _rewriteRequest(AsyncWebServerRequest *request);
 };
@@ -787,6 +1148,8 @@ class DefaultHeaders
 {
     using headers_t = LinkedList<AsyncWebHeader *>;
     headers_t _headers;
+    // Every header pre-rendered as "name: value\r\n", appended as is to each response head
+    String _block;
 
     /////////////////////////////////////////////////
 
@@ -807,6 +1170,38 @@ class DefaultHeaders
     void addHeader(const String& name, const String& value)
     {
       _headers.add(new AsyncWebHeader(name, value));
+
+      _block.concat(name);
+      _block.concat(": ");
+      _block.concat(value);
+      _block.concat("\r\n");
+    }
+
+    /////////////////////////////////////////////////
+
+    bool hasHeader(const String& name) const
+    {
+      for (const auto& header : _headers)
+      {
+        if (header->name().equalsIgnoreCase(name))
+          return true;
+      }
+
+      return false;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline const String& block() const
+    {
+      return _block;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline bool isEmpty() const
+    {
+      return _headers.isEmpty();
     }
 
     /////////////////////////////////////////////////
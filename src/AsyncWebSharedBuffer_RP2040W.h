@@ -0,0 +1,190 @@
+/****************************************************************************************************************************
+  AsyncWebSharedBuffer_RP2040W.h
+
+  For RP2040W with CYW43439 WiFi
+
+  AsyncWebServer_RP2040W is a library for the RP2040W with CYW43439 WiFi
+
+  Based on and modified from ESPAsyncWebServer (https://github.com/me-no-dev/ESPAsyncWebServer)
+  Built by Khoi Hoang https://github.com/khoih-prog/AsyncWebServer_RP2040W
+  Licensed under GPLv3 license
+
+  Version: 1.5.0
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      13/08/2022 Initial coding for RP2040W with CYW43439 WiFi
+  ...
+  1.3.0   K Hoang      10/10/2022 Fix crash when using AsyncWebSockets server
+  1.3.1   K Hoang      10/10/2022 Improve robustness of AsyncWebSockets server
+  1.4.0   K Hoang      20/10/2022 Add LittleFS functions such as AsyncFSWebServer
+  1.4.1   K Hoang      10/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.4.2   K Hoang      28/01/2023 Add Async_AdvancedWebServer_SendChunked_MQTT and AsyncWebServer_MQTT_RP2040W examples
+  1.5.0   K Hoang      30/01/2023 Fix _catchAllHandler not working bug
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef RP2040W_ASYNCWEBSHAREDBUFFER_H_
+#define RP2040W_ASYNCWEBSHAREDBUFFER_H_
+
+#include "stddef.h"
+#include "stdint.h"
+#include "stdlib.h"
+#include "string.h"
+#include <new>
+
+/////////////////////////////////////////////////
+
+/*
+   SHARED BUFFER :: Ref-counted payload, written once by its creator and then only read. A message
+   broadcast to N WebSocket or EventSource clients is one of these, each client queue holding a
+   reference plus its own offsets. Header, data and a trailing NUL are a single malloc
+
+   Up to `headroom` bytes in front of the data can hold a prefix computed once for every client,
+   such as the frame header of a broadcast WebSocket message. The first prefix set stays : it
+   may already be on its way to a client
+ * */
+
+class AsyncWebSharedBuffer
+{
+  private:
+    static const size_t ALIGN = sizeof(void*) * 2;
+
+    uint32_t  _refs;
+    size_t    _len;
+    uint8_t   _headroom;
+    uint8_t   _prefixLen;
+    uint8_t   _prefixTag;
+
+    /////////////////////////////////////////////////
+
+    AsyncWebSharedBuffer(size_t len, uint8_t headroom)
+      : _refs(1), _len(len), _headroom(headroom), _prefixLen(0), _prefixTag(0) {}
+
+    /////////////////////////////////////////////////
+
+    static inline size_t _align(size_t size)
+    {
+      return (size + ALIGN - 1) & ~(ALIGN - 1);
+    }
+
+    /////////////////////////////////////////////////
+
+    inline uint8_t* _base() const
+    {
+      return (uint8_t*) this + _align(sizeof(AsyncWebSharedBuffer));
+    }
+
+  public:
+
+    // One reference, owned by the caller. NULL if out of heap
+    static AsyncWebSharedBuffer* create(size_t len, uint8_t headroom = 0)
+    {
+      void* mem = malloc(_align(sizeof(AsyncWebSharedBuffer)) + headroom + len + 1);
+
+      if (mem == NULL)
+        return NULL;
+
+      AsyncWebSharedBuffer* buffer = new (mem) AsyncWebSharedBuffer(len, headroom);
+      buffer->data()[len] = 0;
+
+      return buffer;
+    }
+
+    /////////////////////////////////////////////////
+
+    static AsyncWebSharedBuffer* create(const uint8_t* data, size_t len, uint8_t headroom = 0)
+    {
+      AsyncWebSharedBuffer* buffer = create(len, headroom);
+
+      if (buffer && data)
+        memcpy(buffer->data(), data, len);
+
+      return buffer;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline AsyncWebSharedBuffer* ref()
+    {
+      _refs++;
+
+      return this;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Freed with the last reference
+    inline void unref()
+    {
+      if (--_refs == 0)
+      {
+        this->~AsyncWebSharedBuffer();
+        free(this);
+      }
+    }
+
+    /////////////////////////////////////////////////
+
+    inline uint32_t refs() const
+    {
+      return _refs;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline uint8_t* data() const
+    {
+      return _base() + _headroom;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline size_t length() const
+    {
+      return _len;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Only before the buffer is shared, e.g. once compressed data turns out shorter than reserved
+    inline void truncate(size_t len)
+    {
+      if (len < _len)
+      {
+        _len = len;
+        data()[len] = 0;
+      }
+    }
+
+    /////////////////////////////////////////////////
+
+    // false if it doesn't fit the headroom, or a prefix is already set
+    bool setPrefix(uint8_t tag, const uint8_t* prefix, uint8_t len)
+    {
+      if (_prefixLen || (len == 0) || (len > _headroom))
+        return false;
+
+      memcpy(data() - len, prefix, len);
+      _prefixTag = tag;
+      _prefixLen = len;
+
+      return true;
+    }
+
+    /////////////////////////////////////////////////
+
+    // The prefix, directly followed by the data, or NULL if none was set for tag
+    inline const uint8_t* prefix(uint8_t tag, size_t& len) const
+    {
+      if (!_prefixLen || (_prefixTag != tag))
+        return NULL;
+
+      len = _prefixLen;
+
+      return data() - _prefixLen;
+    }
+};
+
+#endif /* RP2040W_ASYNCWEBSHAREDBUFFER_H_ */
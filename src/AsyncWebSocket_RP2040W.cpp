@@ -32,112 +32,152 @@
 #include "AsyncWebServer_RP2040W_Debug.h"
 
 #include "AsyncWebSocket_RP2040W.h"
+#include "AsyncWebDeflate_RP2040W.h"
 
 #include <libb64/cencode.h>
 
 #include "Crypto/sha1.h"
 #include "Crypto/Hash.h"
 
-#define MAX_PRINTF_LEN 64
-
 /////////////////////////////////////////////////
 
-size_t webSocketSendFrameWindow(AsyncClient *client)
+size_t webSocketFrameHeaderLength(size_t len, bool mask)
 {
-  if (!client->canSend())
-    return 0;
+  size_t headLen = 2;
 
-  size_t space = client->space();
+  if (len && mask)
+    headLen += 4;
 
-  if (space < 9)
-    return 0;
+  if (len > 0xFFFF)
+    headLen += 8;
+  else if (len > 125)
+    headLen += 2;
 
-  return (space - 8);
+  return headLen;
 }
 
 /////////////////////////////////////////////////
 
-size_t webSocketSendFrame(AsyncClient *client, bool final, uint8_t opcode, bool mask, uint8_t *data, size_t len)
+size_t webSocketSendFrameWindow(AsyncClient *client)
 {
   if (!client->canSend())
     return 0;
 
   size_t space = client->space();
 
-  if (space < 2)
+  if (space < 9)
     return 0;
 
-  uint8_t mbuf[4] = {0, 0, 0, 0};
-  uint8_t headLen = 2;
+  // Leave room for the largest header a payload of this size can need
+  if (space > (0xFFFF + 8))
+    return (space - 14);
 
-  if (len && mask)
-  {
-    headLen += 4;
-    mbuf[0] = rand() % 0xFF;
-    mbuf[1] = rand() % 0xFF;
-    mbuf[2] = rand() % 0xFF;
-    mbuf[3] = rand() % 0xFF;
-  }
+  return (space - 8);
+}
 
-  if (len > 125)
-    headLen += 2;
+/////////////////////////////////////////////////
 
-  if (space < headLen)
-    return 0;
+// XOR len bytes of src with the 4-byte masking key into dst. dst is word aligned and
+// len is a multiple of 4 except for the last piece of a frame, so the key phase never shifts.
+static void webSocketMaskPayload(uint8_t *dst, const uint8_t *src, size_t len, uint32_t maskKey)
+{
+  size_t i = 0;
 
-  space -= headLen;
+  for (; i + 4 <= len; i += 4)
+  {
+    uint32_t word;
 
-  if (len > space)
-    len = space;
+    memcpy(&word, src + i, 4);
+    *(uint32_t *)(dst + i) = word ^ maskKey;
+  }
 
-  uint8_t *buf = (uint8_t*)malloc(headLen);
+  const uint8_t *key = (const uint8_t *)&maskKey;
 
-  if (buf == NULL)
-  {
-    AWS_LOGDEBUG1("Could not malloc for frame header, bytes = ", headLen);
+  for (; i < len; i++)
+    dst[i] = src[i] ^ key[i & 3];
+}
 
-    return 0;
-  }
+/////////////////////////////////////////////////
 
-  buf[0] = opcode & 0x0F;
+// Unmasked header of a frame of len bytes, the mask bit and key being left to the caller
+static void webSocketWriteFrameHeader(uint8_t *buf, bool final, uint8_t opcode, size_t len)
+{
+  buf[0] = opcode & (0x0F | WS_FRAME_RSV1);
 
   if (final)
     buf[0] |= 0x80;
 
   if (len < 126)
     buf[1] = len & 0x7F;
-  else
+  else if (len <= 0xFFFF)
   {
     buf[1] = 126;
     buf[2] = (uint8_t)((len >> 8) & 0xFF);
     buf[3] = (uint8_t)(len & 0xFF);
   }
-
-  if (len && mask)
+  else
   {
-    buf[1] |= 0x80;
-    memcpy(buf + (headLen - 4), mbuf, 4);
+    uint64_t len64 = len;
+
+    buf[1] = 127;
+
+    for (uint8_t i = 0; i < 8; i++)
+      buf[2 + i] = (uint8_t)((len64 >> (8 * (7 - i))) & 0xFF);
   }
+}
 
-  if (client->add((const char *)buf, headLen) != headLen)
-  {
-    AWS_LOGDEBUG1("Error adding header, bytes =", headLen);
+/////////////////////////////////////////////////
 
-    free(buf);
+size_t webSocketSendFrame(AsyncClient *client, bool final, uint8_t opcode, bool mask, uint8_t *data, size_t len)
+{
+  if (!client->canSend())
+    return 0;
+
+  size_t space = client->space();
 
+  if (space < 2)
     return 0;
+
+  size_t headLen = webSocketFrameHeaderLength(len, mask);
+
+  if (space < headLen)
+    return 0;
+
+  if (len > (space - headLen))
+  {
+    len = space - headLen;
+
+    // A shorter payload may need a shorter length field
+    headLen = webSocketFrameHeaderLength(len, mask);
   }
 
-  free(buf);
+  // The header is built on the stack, right in front of a word aligned payload area, so that
+  // short frames and masked payload pieces go to the client in a single add()
+  uint32_t scratch[(WS_FRAME_HEADER_MAX + WS_FRAME_SCRATCH_SIZE) / 4];
+  uint8_t *payload = (uint8_t *)scratch + WS_FRAME_HEADER_MAX;
+  uint8_t *buf     = payload - headLen;
+  uint32_t maskKey = 0;
 
-  if (len)
+  webSocketWriteFrameHeader(buf, final, opcode, len);
+
+  if (len && mask)
+  {
+    buf[1] |= 0x80;
+    maskKey = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    memcpy(payload - 4, &maskKey, 4);
+  }
+
+  // The payload is never masked in place: data may be a buffer shared by several clients
+  size_t done = 0;
+  size_t piece;
+
+  if (!(len && mask) && (len > WS_FRAME_SCRATCH_SIZE))
   {
-    if (len && mask)
+    if (client->add((const char *)buf, headLen, ASYNC_WRITE_FLAG_COPY | ASYNC_WRITE_FLAG_MORE) != headLen)
     {
-      size_t i;
+      AWS_LOGDEBUG1("Error adding header, bytes =", headLen);
 
-      for (i = 0; i < len; i++)
-        data[i] = data[i] ^ mbuf[i % 4];
+      return 0;
     }
 
     if (client->add((const char *)data, len) != len)
@@ -147,6 +187,34 @@ size_t webSocketSendFrame(AsyncClient *client, bool final, uint8_t opcode, bool
       return 0;
     }
   }
+  else
+  {
+    do
+    {
+      piece = len - done;
+
+      if (piece > WS_FRAME_SCRATCH_SIZE)
+        piece = WS_FRAME_SCRATCH_SIZE;
+
+      if (mask)
+        webSocketMaskPayload(payload, data + done, piece, maskKey);
+      else
+        memcpy(payload, data + done, piece);
+
+      size_t toAdd = (payload - buf) + piece;
+
+      if (client->add((const char *)buf, toAdd, ASYNC_WRITE_FLAG_COPY | ((done + piece < len) ? ASYNC_WRITE_FLAG_MORE : 0))
+          != toAdd)
+      {
+        AWS_LOGDEBUG1("Error adding frame, bytes =", toAdd);
+
+        return 0;
+      }
+
+      done += piece;
+      buf = payload;
+    } while (done < len);
+  }
 
   if (!client->send())
   {
@@ -166,7 +234,7 @@ size_t webSocketSendFrame(AsyncClient *client, bool final, uint8_t opcode, bool
 */
 
 AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer()
-  : _data(nullptr), _len(0), _lock(false), _count(0)
+  : _payload(nullptr), _lock(false), _count(0), _key(0)
 {
 
 }
@@ -174,70 +242,52 @@ AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer()
 /////////////////////////////////////////////////
 
 AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(uint8_t * data, size_t size)
-  : _data(nullptr), _len(size), _lock(false), _count(0)
+  : _payload(nullptr), _lock(false), _count(0), _key(0)
 {
   if (!data)
   {
     return;
   }
 
-  _data = new uint8_t[_len + 1];
-
-  if (_data)
-  {
-    memcpy(_data, data, _len);
-    _data[_len] = 0;
-  }
+  _payload = AsyncWebSharedBuffer::create(data, size, WS_FRAME_HEADER_MAX);
 }
 
 /////////////////////////////////////////////////
 
 AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(size_t size)
-  : _data(nullptr), _len(size), _lock(false), _count(0)
+  : _payload(nullptr), _lock(false), _count(0), _key(0)
 {
-  _data = new uint8_t[_len + 1];
-
-  if (_data)
-  {
-    _data[_len] = 0;
-  }
+  _payload = AsyncWebSharedBuffer::create(size, WS_FRAME_HEADER_MAX);
 }
 
 /////////////////////////////////////////////////
 
 AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(const AsyncWebSocketMessageBuffer & copy)
-  : _data(nullptr), _len(0), _lock(false), _count(0)
+  : _payload(nullptr), _lock(false), _count(0), _key(0)
 {
-  _len   = copy._len;
   _lock  = copy._lock;
   _count = 0;
+  _key   = copy._key;
 
-  if (_len)
+  if (copy._payload && copy._payload->length())
   {
-    _data = new uint8_t[_len + 1];
-    _data[_len] = 0;
-  }
-
-  if (_data)
-  {
-    memcpy(_data, copy._data, _len);
-    _data[_len] = 0;
+    _payload = AsyncWebSharedBuffer::create(copy._payload->data(), copy._payload->length(), WS_FRAME_HEADER_MAX);
   }
 }
 
 /////////////////////////////////////////////////
 
 AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(AsyncWebSocketMessageBuffer && copy)
-  : _data(nullptr), _len(0), _lock(false), _count(0)
+  : _payload(nullptr), _lock(false), _count(0), _key(0)
 {
-  _len   = copy._len;
   _lock  = copy._lock;
   _count = 0;
+  _key   = copy._key;
 
-  if (copy._data)
+  if (copy._payload)
   {
-    _data = copy._data;
-    copy._data = nullptr;
+    _payload = copy._payload;
+    copy._payload = nullptr;
   }
 }
 
@@ -245,9 +295,9 @@ AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(AsyncWebSocketMessageBu
 
 AsyncWebSocketMessageBuffer::~AsyncWebSocketMessageBuffer()
 {
-  if (_data)
+  if (_payload)
   {
-    delete[] _data;
+    _payload->unref();
   }
 }
 
@@ -255,27 +305,16 @@ AsyncWebSocketMessageBuffer::~AsyncWebSocketMessageBuffer()
 
 bool AsyncWebSocketMessageBuffer::reserve(size_t size)
 {
-  _len = size;
-
-  if (_data)
+  // Messages still sending the old data keep it alive
+  if (_payload)
   {
-    delete[] _data;
-    _data = nullptr;
+    _payload->unref();
+    _payload = nullptr;
   }
 
-  _data = new uint8_t[_len + 1];
-
-  if (_data)
-  {
-    _data[_len] = 0;
-
-    return true;
-  }
-  else
-  {
-    return false;
-  }
+  _payload = AsyncWebSharedBuffer::create(size, WS_FRAME_HEADER_MAX);
 
+  return (_payload != nullptr);
 }
 
 /////////////////////////////////////////////////
@@ -285,7 +324,7 @@ bool AsyncWebSocketMessageBuffer::reserve(size_t size)
    Control Frame
 */
 
-class AsyncWebSocketControl
+class AsyncWebSocketControl : public LinkedListHook<AsyncWebSocketControl>
 {
   private:
     uint8_t _opcode;
@@ -368,7 +407,7 @@ class AsyncWebSocketControl
 AsyncWebSocketBasicMessage::AsyncWebSocketBasicMessage(const char * data, size_t len, uint8_t opcode, bool mask)
   : _len(len), _sent(0), _ack(0), _acked(0)
 {
-  _opcode = opcode & 0x07;
+  _opcode = opcode & (0x07 | WS_FRAME_RSV1);
   _mask = mask;
   _data = (uint8_t*)malloc(_len + 1);
 
@@ -390,7 +429,7 @@ AsyncWebSocketBasicMessage::AsyncWebSocketBasicMessage(const char * data, size_t
 AsyncWebSocketBasicMessage::AsyncWebSocketBasicMessage(uint8_t opcode, bool mask)
   : _len(0), _sent(0), _ack(0), _acked(0), _data(NULL)
 {
-  _opcode = opcode & 0x07;
+  _opcode = opcode & (0x07 | WS_FRAME_RSV1);
   _mask = mask;
 }
 
@@ -451,7 +490,7 @@ size_t AsyncWebSocketBasicMessage::send(AsyncClient *client)
   }
 
   _sent += toSend;
-  _ack += toSend + ((toSend < 126) ? 2 : 4) + (_mask * 4);
+  _ack += toSend + webSocketFrameHeaderLength(toSend, _mask);
 
   bool final     = (_sent == _len);
   uint8_t* dPtr  = (uint8_t*)(_data + (_sent - toSend));
@@ -476,19 +515,25 @@ size_t AsyncWebSocketBasicMessage::send(AsyncClient *client)
    AsyncWebSocketMultiMessage Message
 */
 AsyncWebSocketMultiMessage::AsyncWebSocketMultiMessage(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode, bool mask)
-  : _len(0), _sent(0), _ack(0), _acked(0), _WSbuffer(nullptr)
+  : _payload(nullptr), _data(nullptr), _len(0), _sent(0), _ack(0), _acked(0), _WSbuffer(nullptr)
 {
 
-  _opcode = opcode & 0x07;
+  _opcode = opcode & (0x07 | WS_FRAME_RSV1);
   _mask = mask;
 
   if (buffer)
   {
     _WSbuffer = buffer;
     (*_WSbuffer)++;
+    _key = buffer->key();
+
+    if (buffer->payload())
+    {
+      _payload = buffer->payload()->ref();
+      _data    = _payload->data();
+      _len     = _payload->length();
+    }
 
-    _data   = buffer->get();
-    _len    = buffer->length();
     _status = WS_MSG_SENDING;
 
     AWS_LOGDEBUG1("M:", _len);
@@ -502,8 +547,36 @@ AsyncWebSocketMultiMessage::AsyncWebSocketMultiMessage(AsyncWebSocketMessageBuff
 
 /////////////////////////////////////////////////
 
+AsyncWebSocketMultiMessage::AsyncWebSocketMultiMessage(AsyncWebSharedBuffer * payload, uint8_t opcode, bool mask)
+  : _payload(nullptr), _data(nullptr), _len(0), _sent(0), _ack(0), _acked(0), _WSbuffer(nullptr)
+{
+  _opcode = opcode & (0x07 | WS_FRAME_RSV1);
+  _mask = mask;
+
+  if (payload)
+  {
+    _payload = payload->ref();
+    _data    = _payload->data();
+    _len     = _payload->length();
+    _status  = WS_MSG_SENDING;
+
+    AWS_LOGDEBUG1("M:", _len);
+  }
+  else
+  {
+    _status = WS_MSG_ERROR;
+  }
+}
+
+/////////////////////////////////////////////////
+
 AsyncWebSocketMultiMessage::~AsyncWebSocketMultiMessage()
 {
+  if (_payload)
+  {
+    _payload->unref();
+  }
+
   if (_WSbuffer)
   {
     (*_WSbuffer)--; // decreases the counter.
@@ -561,8 +634,46 @@ size_t AsyncWebSocketMultiMessage::send(AsyncClient *client)
     toSend = window;
   }
 
+  if (!_sent && !_mask && toSend && (toSend == _len))
+  {
+    // Whole message in one frame : its header sits in the payload headroom, built by the first
+    // client to get here and reused by all the others, so header and data go in a single add()
+    size_t headLen;
+    const uint8_t* frame = _payload->prefix(_opcode, headLen);
+
+    if (!frame)
+    {
+      uint8_t header[WS_FRAME_HEADER_MAX];
+
+      webSocketWriteFrameHeader(header, true, _opcode, _len);
+
+      if (_payload->setPrefix(_opcode, header, webSocketFrameHeaderLength(_len, false)))
+        frame = _payload->prefix(_opcode, headLen);
+    }
+
+    if (frame && (client->space() >= headLen + _len))
+    {
+      size_t sent = client->add((const char *)frame, headLen + _len);
+
+      if ((sent == headLen + _len) && client->send())
+      {
+        _sent   = _len;
+        _ack   += headLen + _len;
+        _status = WS_MSG_SENDING;
+
+        AWS_LOGDEBUG1("Send OK: shared frame, bytes =", sent);
+
+        return _len;
+      }
+
+      AWS_LOGDEBUG1("Error adding shared frame, bytes =", headLen + _len);
+
+      return 0;
+    }
+  }
+
   _sent += toSend;
-  _ack += toSend + ((toSend < 126) ? 2 : 4) + (_mask * 4);
+  _ack += toSend + webSocketFrameHeaderLength(toSend, _mask);
 
   AWS_LOGDEBUG2("W:", _sent - toSend, toSend);
 
@@ -596,12 +707,13 @@ const size_t AWSC_PING_PAYLOAD_LEN = 27;
 
 /////////////////////////////////////////////////
 
-AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server)
-  : _controlQueue(LinkedList<AsyncWebSocketControl * >([](AsyncWebSocketControl * c)
+AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server,
+                                           const AwsDeflateParams *deflate)
+  : _controlQueue(IntrusiveLinkedList<AsyncWebSocketControl>([](AsyncWebSocketControl * c)
 {
   delete  c;
 }))
-, _messageQueue(LinkedList<AsyncWebSocketMessage *>([](AsyncWebSocketMessage *m)
+, _messageQueue(IntrusiveLinkedList<AsyncWebSocketMessage>([](AsyncWebSocketMessage *m)
 {
   delete  m;
 }))
@@ -612,8 +724,23 @@ AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, Async
   _clientId = _server->_getNextId();
   _status = WS_CONNECTED;
   _pstate = 0;
+  _pheaderLen = 0;
   _lastMessageTime = millis();
+
+  memset(&_deflate, 0, sizeof(_deflate));
+
+  if (deflate)
+    _deflate = *deflate;
+
+  _pdeflated = false;
+  _inflateData = NULL;
+  _inflateLen = 0;
+  _inflateHistory = NULL;
+  _inflateHistoryLen = 0;
   _keepAlivePeriod = 0;
+  _queuedBytes = 0;
+  _droppedMessages = 0;
+  _coalescedMessages = 0;
 
   _client->setRxTimeout(0);
 
@@ -656,7 +783,8 @@ AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, Async
   _server->_addClient(this);
   _server->_handleEvent(this, WS_EVT_CONNECT, request, NULL, 0);
 
-  delete request;
+  // Back to the server, deleted or pooled
+  request->_server->_handleDisconnect(request);
 }
 
 /////////////////////////////////////////////////
@@ -665,6 +793,13 @@ AsyncWebSocketClient::~AsyncWebSocketClient()
 {
   _messageQueue.free();
   _controlQueue.free();
+
+  if (_inflateData)
+    free(_inflateData);
+
+  if (_inflateHistory)
+    free(_inflateHistory);
+
   _server->_handleEvent(this, WS_EVT_DISCONNECT, NULL, NULL, 0);
 }
 
@@ -725,7 +860,7 @@ void AsyncWebSocketClient::_runQueue()
 {
   while (!_messageQueue.isEmpty() && _messageQueue.front()->finished())
   {
-    _messageQueue.remove(_messageQueue.front());
+    _dropQueued(_messageQueue.front());
   }
 
   if (!_controlQueue.isEmpty() && (_messageQueue.isEmpty() || _messageQueue.front()->betweenFrames())
@@ -743,7 +878,7 @@ void AsyncWebSocketClient::_runQueue()
 
 bool AsyncWebSocketClient::queueIsFull()
 {
-  if ((_messageQueue.length() >= WS_MAX_QUEUED_MESSAGES) || (_status != WS_CONNECTED) )
+  if (!canSend() || (_status != WS_CONNECTED) )
     return true;
 
   return false;
@@ -751,6 +886,97 @@ bool AsyncWebSocketClient::queueIsFull()
 
 /////////////////////////////////////////////////
 
+bool AsyncWebSocketClient::canSend()
+{
+  return (_messageQueue.length() < _server->queueMaxMessages())
+         && (!_server->queueMaxBytes() || (_queuedBytes < _server->queueMaxBytes()));
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebSocketClient::_dropQueued(AsyncWebSocketMessage *dataMessage)
+{
+  _queuedBytes -= dataMessage->length();
+  _messageQueue.remove(dataMessage);
+}
+
+/////////////////////////////////////////////////
+
+// Apply the server queue policy until dataMessage fits. Never blocks, and never drops the head
+// of the queue : it may be partly sent, and acks are counted against it
+bool AsyncWebSocketClient::_makeQueueRoom(AsyncWebSocketMessage *dataMessage)
+{
+  const size_t maxMessages = _server->queueMaxMessages();
+  const size_t maxBytes    = _server->queueMaxBytes();
+  const size_t len         = dataMessage->length();
+
+  auto full = [&]()
+  {
+    return (_messageQueue.length() >= maxMessages)
+           || (maxBytes && !_messageQueue.isEmpty() && (_queuedBytes + len > maxBytes));
+  };
+
+  if (!full())
+    return true;
+
+  switch (_server->queuePolicy())
+  {
+    case WS_QUEUE_COALESCE:
+      if (dataMessage->key())
+      {
+        AsyncWebSocketMessage * match = NULL;
+
+        // The oldest one with the key, i.e. the most stale
+        for (AsyncWebSocketMessage * m = _messageQueue.front()->_listNext; m && !match; m = m->_listNext)
+        {
+          if (m->key() == dataMessage->key())
+            match = m;
+        }
+
+        if (match)
+        {
+          _dropQueued(match);
+          _coalescedMessages++;
+
+          if (!full())
+            return true;
+        }
+      }
+
+    // fall through
+
+    case WS_QUEUE_DROP_OLDEST:
+      while (full() && _messageQueue.front()->_listNext)
+      {
+        _dropQueued(_messageQueue.front()->_listNext);
+        _droppedMessages++;
+      }
+
+      return !full();
+
+    case WS_QUEUE_DISCONNECT:
+      AWS_LOGERROR1("Send queue full, closing client", _clientId);
+
+      while (_messageQueue.front()->_listNext)
+      {
+        _dropQueued(_messageQueue.front()->_listNext);
+        _droppedMessages++;
+      }
+
+      // The connection goes down as soon as the close frame is acked, without waiting for the reply
+      close(1008, "Send queue full");
+      _status = WS_DISCONNECTING;
+
+      return false;
+
+    case WS_QUEUE_DROP_NEWEST:
+    default:
+      return false;
+  }
+}
+
+/////////////////////////////////////////////////
+
 void AsyncWebSocketClient::_queueMessage(AsyncWebSocketMessage *dataMessage)
 {
   if (dataMessage == NULL)
@@ -763,20 +989,17 @@ void AsyncWebSocketClient::_queueMessage(AsyncWebSocketMessage *dataMessage)
     return;
   }
 
-  if (_messageQueue.length() >= WS_MAX_QUEUED_MESSAGES)
+  if (_makeQueueRoom(dataMessage))
   {
-    AWS_LOGERROR("ERROR: Large MsQ");
-    delete dataMessage;
-
-    // KH, fix _messageQueue overflowed by discarding all in the queue
-    _messageQueue.free();
-
-    delay(20);
-    //////
+    _messageQueue.add(dataMessage);
+    _queuedBytes += dataMessage->length();
   }
   else
   {
-    _messageQueue.add(dataMessage);
+    AWS_LOGDEBUG1("Send queue full, message dropped, client", _clientId);
+
+    _droppedMessages++;
+    delete dataMessage;
   }
 
   if (_client->canSend())
@@ -785,6 +1008,72 @@ void AsyncWebSocketClient::_queueMessage(AsyncWebSocketMessage *dataMessage)
 
 /////////////////////////////////////////////////
 
+void AsyncWebSocketClient::_queueData(const char * data, size_t len, uint8_t opcode)
+{
+  if (_deflate.enabled && (len >= WS_DEFLATE_MIN_SIZE))
+  {
+    AsyncWebSharedBuffer * deflated = _server->_deflatePayload((const uint8_t *) data, len, _deflate.serverWindowBits);
+
+    if (deflated)
+    {
+      _queueMessage(new AsyncWebSocketMultiMessage(deflated, opcode | WS_FRAME_RSV1));
+      deflated->unref();
+
+      return;
+    }
+  }
+
+  _queueMessage(new AsyncWebSocketBasicMessage(data, len, opcode));
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebSocketClient::_queueBuffer(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode)
+{
+  if (buffer && _deflate.enabled && (buffer->length() >= WS_DEFLATE_MIN_SIZE))
+  {
+    AsyncWebSharedBuffer * deflated = _server->_deflatePayload(buffer->get(), buffer->length(), _deflate.serverWindowBits);
+
+    if (deflated)
+    {
+      AsyncWebSocketMessage * message = new AsyncWebSocketMultiMessage(deflated, opcode | WS_FRAME_RSV1);
+
+      if (message)
+        message->setKey(buffer->key());
+
+      _queueMessage(message);
+      deflated->unref();
+
+      return;
+    }
+  }
+
+  _queueMessage(new AsyncWebSocketMultiMessage(buffer, opcode));
+}
+
+/////////////////////////////////////////////////
+
+// The message takes its own reference to payload
+void AsyncWebSocketClient::_queuePayload(AsyncWebSharedBuffer * payload, uint8_t opcode)
+{
+  if (payload && _deflate.enabled && (payload->length() >= WS_DEFLATE_MIN_SIZE))
+  {
+    AsyncWebSharedBuffer * deflated = _server->_deflatePayload(payload->data(), payload->length(), _deflate.serverWindowBits);
+
+    if (deflated)
+    {
+      _queueMessage(new AsyncWebSocketMultiMessage(deflated, opcode | WS_FRAME_RSV1));
+      deflated->unref();
+
+      return;
+    }
+  }
+
+  _queueMessage(new AsyncWebSocketMultiMessage(payload, opcode));
+}
+
+/////////////////////////////////////////////////
+
 void AsyncWebSocketClient::_queueControl(AsyncWebSocketControl *controlMessage)
 {
   if (controlMessage == NULL)
@@ -841,30 +1130,131 @@ void AsyncWebSocketClient::close(uint16_t code, const char * message)
 
 /////////////////////////////////////////////////
 
-void AsyncWebSocketClient::ping(uint8_t *data, size_t len)
+void AsyncWebSocketClient::ping(uint8_t *data, size_t len)
+{
+  if (_status == WS_CONNECTED)
+    _queueControl(new AsyncWebSocketControl(WS_PING, data, len));
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebSocketClient::_onError(int8_t) {}
+
+/////////////////////////////////////////////////
+
+void AsyncWebSocketClient::_onTimeout(uint32_t time)
+{
+  RP2040W_AWS_UNUSED(time);
+  _client->close(true);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebSocketClient::_onDisconnect()
+{
+  _client = NULL;
+  _server->_handleDisconnect(this);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebSocketClient::_parseFrameHeader(const uint8_t *header)
+{
+  const uint8_t *first = header;
+
+  _pinfo.index = 0;
+  _pinfo.final = (header[0] & 0x80) != 0;
+  _pinfo.opcode = header[0] & 0x0F;
+  _pinfo.masked = (header[1] & 0x80) != 0;
+  _pinfo.len = header[1] & 0x7F;
+
+  header += 2;
+
+  if (_pinfo.len == 126)
+  {
+    _pinfo.len = header[1] | (uint16_t)(header[0]) << 8;
+
+    header += 2;
+  }
+  else if (_pinfo.len == 127)
+  {
+    _pinfo.len = 0;
+
+    for (uint8_t i = 0; i < 8; i++)
+      _pinfo.len = (_pinfo.len << 8) | header[i];
+
+    header += 8;
+  }
+
+  if (_pinfo.masked)
+    memcpy(_pinfo.mask, header, 4);
+
+  if (_pinfo.opcode && (_pinfo.opcode < 8))
+  {
+    // First frame of a message. RSV1 set : the message is compressed
+    _pinfo.message_opcode = _pinfo.opcode;
+    _pinfo.num = 0;
+    _pdeflated = _deflate.enabled && (first[0] & WS_FRAME_RSV1);
+  }
+  else if (_pinfo.opcode == WS_CONTINUATION)
+    _pinfo.num += 1;
+}
+
+/////////////////////////////////////////////////
+
+// Size of the whole frame header, known once its first two bytes are in
+static inline size_t webSocketReceivedHeaderLength(const uint8_t *header)
+{
+  size_t headLen = 2;
+
+  if ((header[1] & 0x7F) == 126)
+    headLen += 2;
+  else if ((header[1] & 0x7F) == 127)
+    headLen += 8;
+
+  if (header[1] & 0x80)
+    headLen += 4;
+
+  return headLen;
+}
+
+/////////////////////////////////////////////////
+
+// Unmask len bytes in place. phase is the frame offset of data[0], selecting the key byte
+// it was masked with. Whole words are XORed once data is word aligned
+static void webSocketUnmaskPayload(uint8_t *data, size_t len, const uint8_t *mask, size_t phase)
 {
-  if (_status == WS_CONNECTED)
-    _queueControl(new AsyncWebSocketControl(WS_PING, data, len));
-}
+  while (len && ((uintptr_t)data & 3))
+  {
+    *data++ ^= mask[phase++ & 3];
+    len--;
+  }
 
-/////////////////////////////////////////////////
+  if (len >= 4)
+  {
+    uint8_t rotated[4] = { mask[phase & 3], mask[(phase + 1) & 3], mask[(phase + 2) & 3], mask[(phase + 3) & 3] };
+    uint32_t key;
 
-void AsyncWebSocketClient::_onError(int8_t) {}
+    memcpy(&key, rotated, 4);
 
-/////////////////////////////////////////////////
+    for (; len >= 4; len -= 4, data += 4)
+      *(uint32_t *)data ^= key;
+  }
 
-void AsyncWebSocketClient::_onTimeout(uint32_t time)
-{
-  RP2040W_AWS_UNUSED(time);
-  _client->close(true);
+  while (len--)
+    *data++ ^= mask[phase++ & 3];
 }
 
 /////////////////////////////////////////////////
 
-void AsyncWebSocketClient::_onDisconnect()
+// RFC 6455 7.1.7 : the frame boundaries are lost, so close without reading anything more. The TCP
+// connection goes down once the close frame is acked
+void AsyncWebSocketClient::_failConnection(uint16_t code)
 {
-  _client = NULL;
-  _server->_handleDisconnect(this);
+  close(code);
+
+  _status = WS_DISCONNECTING;
+  _pstate = 2;
 }
 
 /////////////////////////////////////////////////
@@ -874,43 +1264,53 @@ void AsyncWebSocketClient::_onData(void *pbuf, size_t plen)
   _lastMessageTime = millis();
   uint8_t *data = (uint8_t*)pbuf;
 
+  if (_pstate == 2)
+    return;
+
   while (plen > 0)
   {
     if (!_pstate)
     {
-      const uint8_t *fdata = data;
-
-      _pinfo.index = 0;
-      _pinfo.final = (fdata[0] & 0x80) != 0;
-      _pinfo.opcode = fdata[0] & 0x0F;
-      _pinfo.masked = (fdata[1] & 0x80) != 0;
-      _pinfo.len = fdata[1] & 0x7F;
+      size_t headLen = ((_pheaderLen == 0) && (plen >= 2)) ? webSocketReceivedHeaderLength(data) : 0;
 
-      data += 2;
-      plen -= 2;
-
-      if (_pinfo.len == 126)
+      if (headLen && (plen >= headLen))
       {
-        _pinfo.len = fdata[3] | (uint16_t)(fdata[2]) << 8;
+        // Whole header in this segment, parse it where it is
+        _parseFrameHeader(data);
 
-        data += 2;
-        plen -= 2;
+        data += headLen;
+        plen -= headLen;
       }
-      else if (_pinfo.len == 127)
+      else
       {
-        _pinfo.len = fdata[9] | (uint16_t)(fdata[8]) << 8 | (uint32_t)(fdata[7]) << 16 | (uint32_t)(fdata[6]) << 24
-                     | (uint64_t)(fdata[5]) << 32 | (uint64_t)(fdata[4]) << 40 | (uint64_t)(fdata[3]) << 48 | (uint64_t)(fdata[2]) << 56;
+        // Collect the header across segments: first the two fixed bytes, which give its full length
+        size_t need = (_pheaderLen < 2) ? 2 : webSocketReceivedHeaderLength(_pheader);
 
-        data += 8;
-        plen -= 8;
+        while ((_pheaderLen < need) && plen)
+        {
+          _pheader[_pheaderLen++] = *data++;
+          plen--;
+
+          if (_pheaderLen == 2)
+            need = webSocketReceivedHeaderLength(_pheader);
+        }
+
+        if (_pheaderLen < need)
+          break;
+
+        _parseFrameHeader(_pheader);
+        _pheaderLen = 0;
       }
 
-      if (_pinfo.masked)
+      _pstate = 1;
+
+      if ((_pinfo.opcode & 0x08) && (_pinfo.len > WS_MAX_CONTROL_PAYLOAD))
       {
-        memcpy(_pinfo.mask, data, 4);
+        AWS_LOGDEBUG1("Control frame too long: len =", _pinfo.len);
+
+        _failConnection(1002);
 
-        data += 4;
-        plen -= 4;
+        return;
       }
     }
 
@@ -918,27 +1318,20 @@ void AsyncWebSocketClient::_onData(void *pbuf, size_t plen)
     const auto datalast = data[datalen];
 
     if (_pinfo.masked)
+      webSocketUnmaskPayload(data, datalen, _pinfo.mask, (size_t)_pinfo.index);
+
+    if (((datalen + _pinfo.index) < _pinfo.len) && (_pinfo.opcode & 0x08))
     {
-      for (size_t i = 0; i < datalen; i++)
-        data[i] ^= _pinfo.mask[(_pinfo.index + i) % 4];
+      // Control frame split across segments, keep its payload until it is complete
+      memcpy(_pcontrol + _pinfo.index, data, datalen);
+      _pinfo.index += datalen;
     }
-
-    if ((datalen + _pinfo.index) < _pinfo.len)
+    else if ((datalen + _pinfo.index) < _pinfo.len)
     {
-      _pstate = 1;
-
-      if (_pinfo.index == 0)
-      {
-        if (_pinfo.opcode)
-        {
-          _pinfo.message_opcode = _pinfo.opcode;
-          _pinfo.num = 0;
-        }
-        else
-          _pinfo.num += 1;
-      }
-
-      _server->_handleEvent(this, WS_EVT_DATA, (void *)&_pinfo, (uint8_t*)data, datalen);
+      if (_pdeflated)
+        _inflateAppend(data, datalen);
+      else
+        _server->_handleEvent(this, WS_EVT_DATA, (void *)&_pinfo, (uint8_t*)data, datalen);
 
       _pinfo.index += datalen;
     }
@@ -946,12 +1339,24 @@ void AsyncWebSocketClient::_onData(void *pbuf, size_t plen)
     {
       _pstate = 0;
 
+      uint8_t *payload  = data;
+      size_t payloadLen = datalen;
+
+      if ((_pinfo.opcode & 0x08) && _pinfo.index)
+      {
+        memcpy(_pcontrol + _pinfo.index, data, datalen);
+        _pcontrol[_pinfo.len] = 0;
+
+        payload    = _pcontrol;
+        payloadLen = (size_t) _pinfo.len;
+      }
+
       if (_pinfo.opcode == WS_DISCONNECT)
       {
-        if (datalen)
+        if (payloadLen)
         {
-          uint16_t reasonCode = (uint16_t)(data[0] << 8) + data[1];
-          char * reasonString = (char*)(data + 2);
+          uint16_t reasonCode = (uint16_t)(payload[0] << 8) + payload[1];
+          char * reasonString = (char*)(payload + 2);
 
           if (reasonCode > 1001)
           {
@@ -968,17 +1373,24 @@ void AsyncWebSocketClient::_onData(void *pbuf, size_t plen)
         {
           _status = WS_DISCONNECTING;
           _client->ackLater();
-          _queueControl(new AsyncWebSocketControl(WS_DISCONNECT, data, datalen));
+          _queueControl(new AsyncWebSocketControl(WS_DISCONNECT, payload, payloadLen));
         }
       }
       else if (_pinfo.opcode == WS_PING)
       {
-        _queueControl(new AsyncWebSocketControl(WS_PONG, data, datalen));
+        _queueControl(new AsyncWebSocketControl(WS_PONG, payload, payloadLen));
       }
       else if (_pinfo.opcode == WS_PONG)
       {
-        if (datalen != AWSC_PING_PAYLOAD_LEN || memcmp(AWSC_PING_PAYLOAD, data, AWSC_PING_PAYLOAD_LEN) != 0)
-          _server->_handleEvent(this, WS_EVT_PONG, NULL, data, datalen);
+        if (payloadLen != AWSC_PING_PAYLOAD_LEN || memcmp(AWSC_PING_PAYLOAD, payload, AWSC_PING_PAYLOAD_LEN) != 0)
+          _server->_handleEvent(this, WS_EVT_PONG, NULL, payload, payloadLen);
+      }
+      else if ((_pinfo.opcode < 8) && _pdeflated)
+      {
+        _inflateAppend(data, datalen);
+
+        if (_pinfo.final)
+          _inflateMessage();
       }
       else if (_pinfo.opcode < 8)
       {
@@ -991,8 +1403,9 @@ void AsyncWebSocketClient::_onData(void *pbuf, size_t plen)
       AWS_LOGDEBUG3("Frame Error: len =", datalen, "index =", _pinfo.index);
       AWS_LOGDEBUG1("Frame Error: total =", _pinfo.len);
 
-      //what should we do?
-      break;
+      _failConnection(1002);
+
+      return;
     }
 
     // restore byte as _handleEvent may have added a null terminator i.e., data[len] = 0;
@@ -1006,47 +1419,147 @@ void AsyncWebSocketClient::_onData(void *pbuf, size_t plen)
 
 /////////////////////////////////////////////////
 
-size_t AsyncWebSocketClient::printf(const char *format, ...)
+void AsyncWebSocketClient::_inflateAppend(const uint8_t *data, size_t len)
 {
-  va_list arg;
-  va_start(arg, format);
-  char* temp = new char[MAX_PRINTF_LEN];
+  if (_status != WS_CONNECTED)
+    return;
 
-  if (!temp)
+  if (_inflateLen + len > WS_DEFLATE_MAX_MESSAGE)
   {
-    va_end(arg);
+    AWS_LOGDEBUG1("Compressed message too long, bytes =", _inflateLen + len);
 
-    return 0;
+    close(1009);
+
+    return;
   }
 
-  char* buffer = temp;
-  size_t len = vsnprintf(temp, MAX_PRINTF_LEN, format, arg);
-  va_end(arg);
+  // 4 spare bytes for the 0x00 0x00 0xFF 0xFF tail the sender left out
+  uint8_t *buf = (uint8_t *) realloc(_inflateData, _inflateLen + len + 4);
+
+  if (buf == NULL)
+  {
+    AWS_LOGDEBUG1("Could not realloc inflate buffer, bytes =", _inflateLen + len + 4);
+
+    close(1009);
+
+    return;
+  }
+
+  memcpy(buf + _inflateLen, data, len);
+
+  _inflateData = buf;
+  _inflateLen += len;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebSocketClient::_inflateMessage()
+{
+  if ((_status != WS_CONNECTED) || (_inflateData == NULL))
+  {
+    if (_inflateData)
+      free(_inflateData);
 
-  if (len > (MAX_PRINTF_LEN - 1))
+    _inflateData = NULL;
+    _inflateLen  = 0;
+
+    return;
+  }
+
+  static const uint8_t tail[4] = { 0x00, 0x00, 0xFF, 0xFF };
+  const size_t historyLen = _inflateHistoryLen;
+  size_t len;
+
+  memcpy(_inflateData + _inflateLen, tail, 4);
+
+  uint8_t *out = AsyncWebDeflate::inflate(_inflateData, _inflateLen + 4, _inflateHistory, historyLen,
+                                          WS_DEFLATE_MAX_MESSAGE, &len);
+
+  free(_inflateData);
+  _inflateData = NULL;
+  _inflateLen  = 0;
+
+  if (out == NULL)
   {
-    buffer = new char[len + 1];
+    close(1009);
 
-    if (!buffer)
+    return;
+  }
+
+  if (!_deflate.clientNoContextTakeover)
+  {
+    // Keep the window the client's next message may refer back to
+    size_t window = (size_t) 1 << _deflate.clientWindowBits;
+    size_t total  = historyLen + len;
+    size_t keep   = std::min(window, total);
+
+    if (_inflateHistory == NULL)
+      _inflateHistory = (uint8_t *) malloc(window);
+
+    if (_inflateHistory == NULL)
     {
-      delete[] temp;
+      free(out);
+      close(1009);
 
-      return 0;
+      return;
     }
 
-    va_start(arg, format);
-    vsnprintf(buffer, len + 1, format, arg);
-    va_end(arg);
+    memcpy(_inflateHistory, out + total - keep, keep);
+    _inflateHistoryLen = keep;
+  }
+
+  // Delivered as one single frame message
+  AwsFrameInfo info = _pinfo;
+
+  info.opcode = info.message_opcode;
+  info.num    = 0;
+  info.final  = 1;
+  info.index  = 0;
+  info.len    = len;
+
+  _server->_handleEvent(this, WS_EVT_DATA, (void *)&info, out + historyLen, len);
+
+  free(out);
+}
+
+/////////////////////////////////////////////////
+
+size_t AsyncWebSocketClient::printf(const char *format, ...)
+{
+  va_list arg;
+  va_start(arg, format);
+  size_t len = vprintf(format, arg);
+  va_end(arg);
+
+  return len;
+}
+
+/////////////////////////////////////////////////
+
+// Formatted straight into the payload the message keeps : one allocation, no temporary copy
+size_t AsyncWebSocketClient::vprintf(const char *format, va_list arg)
+{
+  va_list argCopy;
+  va_copy(argCopy, arg);
+  int len = vsnprintf(NULL, 0, format, argCopy);
+  va_end(argCopy);
+
+  if (len < 0)
+  {
+    return 0;
   }
 
-  text(buffer, len);
+  AsyncWebSharedBuffer * payload = AsyncWebSharedBuffer::create(len, WS_FRAME_HEADER_MAX);
 
-  if (buffer != temp)
+  if (!payload)
   {
-    delete[] buffer;
+    return 0;
   }
 
-  delete[] temp;
+  vsnprintf((char *) payload->data(), len + 1, format, arg);
+
+  _queuePayload(payload, WS_TEXT);
+  payload->unref();
 
   return len;
 }
@@ -1055,7 +1568,7 @@ size_t AsyncWebSocketClient::printf(const char *format, ...)
 
 void AsyncWebSocketClient::text(const char * message, size_t len)
 {
-  _queueMessage(new AsyncWebSocketBasicMessage(message, len));
+  _queueData(message, len, WS_TEXT);
 }
 
 /////////////////////////////////////////////////
@@ -1090,14 +1603,14 @@ void AsyncWebSocketClient::text(const String & message)
 
 void AsyncWebSocketClient::text(AsyncWebSocketMessageBuffer * buffer)
 {
-  _queueMessage(new AsyncWebSocketMultiMessage(buffer));
+  _queueBuffer(buffer, WS_TEXT);
 }
 
 /////////////////////////////////////////////////
 
 void AsyncWebSocketClient::binary(const char * message, size_t len)
 {
-  _queueMessage(new AsyncWebSocketBasicMessage(message, len, WS_BINARY));
+  _queueData(message, len, WS_BINARY);
 }
 
 /////////////////////////////////////////////////
@@ -1132,7 +1645,7 @@ void AsyncWebSocketClient::binary(const String & message)
 
 void AsyncWebSocketClient::binary(AsyncWebSocketMessageBuffer * buffer)
 {
-  _queueMessage(new AsyncWebSocketMultiMessage(buffer, WS_BINARY));
+  _queueBuffer(buffer, WS_BINARY);
 }
 
 /////////////////////////////////////////////////
@@ -1172,7 +1685,9 @@ AsyncWebSocket::AsyncWebSocket(const String & url)
 {
   delete c;
 }))
-, _cNextId(1), _enabled(true), _buffers(LinkedList<AsyncWebSocketMessageBuffer *>([](AsyncWebSocketMessageBuffer * b)
+, _cNextId(1), _enabled(true), _deflateEnabled(false), _deflateWindowBits(WS_DEFLATE_WINDOW_BITS)
+, _deflateNoContextTakeover(true), _queueMaxMessages(WS_MAX_QUEUED_MESSAGES ? WS_MAX_QUEUED_MESSAGES : 1)
+, _queueMaxBytes(WS_MAX_QUEUED_BYTES), _queuePolicy(WS_QUEUE_POLICY), _buffers(LinkedList<AsyncWebSocketMessageBuffer *>([](AsyncWebSocketMessageBuffer * b)
 {
   delete b;
 }))
@@ -1329,21 +1844,7 @@ void AsyncWebSocket::text(uint32_t id, const char * message, size_t len)
 
 void AsyncWebSocket::textAll(AsyncWebSocketMessageBuffer * buffer)
 {
-  if (!buffer)
-    return;
-
-  buffer->lock();
-
-  for (const auto& c : _clients)
-  {
-    if (c->status() == WS_CONNECTED)
-    {
-      c->text(buffer);
-    }
-  }
-
-  buffer->unlock();
-  _cleanBuffers();
+  _bufferAll(buffer, WS_TEXT);
 }
 
 /////////////////////////////////////////////////
@@ -1375,18 +1876,61 @@ void AsyncWebSocket::binaryAll(const char * message, size_t len)
 /////////////////////////////////////////////////
 
 void AsyncWebSocket::binaryAll(AsyncWebSocketMessageBuffer * buffer)
+{
+  _bufferAll(buffer, WS_BINARY);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebSocket::_bufferAll(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode)
 {
   if (!buffer)
     return;
 
   buffer->lock();
 
+  // Server messages carry no context, so one compressed copy, made with the smallest window
+  // any client agreed to, serves all the clients using permessage-deflate
+  AsyncWebSharedBuffer * deflated = NULL;
+
+  if (buffer->length() >= WS_DEFLATE_MIN_SIZE)
+  {
+    uint8_t windowBits = 0;
+
+    for (const auto& c : _clients)
+    {
+      if ((c->status() == WS_CONNECTED) && c->deflateParams().enabled)
+      {
+        if (!windowBits || (c->deflateParams().serverWindowBits < windowBits))
+          windowBits = c->deflateParams().serverWindowBits;
+      }
+    }
+
+    if (windowBits)
+      deflated = _deflatePayload(buffer->get(), buffer->length(), windowBits);
+  }
+
   for (const auto& c : _clients)
   {
     if (c->status() == WS_CONNECTED)
-      c->binary(buffer);
+    {
+      if (deflated && c->deflateParams().enabled)
+      {
+        AsyncWebSocketMessage * message = new AsyncWebSocketMultiMessage(deflated, opcode | WS_FRAME_RSV1);
+
+        if (message)
+          message->setKey(buffer->key());
+
+        c->message(message);
+      }
+      else
+        c->message(new AsyncWebSocketMultiMessage(buffer, opcode));
+    }
   }
 
+  if (deflated)
+    deflated->unref();
+
   buffer->unlock();
   _cleanBuffers();
 }
@@ -1424,7 +1968,7 @@ size_t AsyncWebSocket::printf(uint32_t id, const char *format, ...)
   {
     va_list arg;
     va_start(arg, format);
-    size_t len = c->printf(format, arg);
+    size_t len = c->vprintf(format, arg);
     va_end(arg);
 
     return len;
@@ -1438,18 +1982,17 @@ size_t AsyncWebSocket::printf(uint32_t id, const char *format, ...)
 size_t AsyncWebSocket::printfAll(const char *format, ...)
 {
   va_list arg;
-  char* temp = new char[MAX_PRINTF_LEN];
 
-  if (!temp)
+  va_start(arg, format);
+  int printed = vsnprintf(NULL, 0, format, arg);
+  va_end(arg);
+
+  if (printed < 0)
   {
     return 0;
   }
 
-  va_start(arg, format);
-  size_t len = vsnprintf(temp, MAX_PRINTF_LEN, format, arg);
-  va_end(arg);
-  delete[] temp;
-
+  size_t len = printed;
   AsyncWebSocketMessageBuffer * buffer = makeBuffer(len);
 
   if (!buffer)
@@ -1586,11 +2129,23 @@ const char * WS_STR_ORIGIN     = "Origin";
 const char * WS_STR_VERSION    = "Sec-WebSocket-Version";
 const char * WS_STR_KEY        = "Sec-WebSocket-Key";
 const char * WS_STR_PROTOCOL   = "Sec-WebSocket-Protocol";
+const char * WS_STR_EXTENSIONS = "Sec-WebSocket-Extensions";
+const char * WS_STR_DEFLATE    = "permessage-deflate";
 const char * WS_STR_ACCEPT     = "Sec-WebSocket-Accept";
 const char * WS_STR_UUID       = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
 
 /////////////////////////////////////////////////
 
+WebRouteType AsyncWebSocket::route(String& pattern, WebRequestMethodComposite& methods)
+{
+  pattern = _url;
+  methods = HTTP_GET;
+
+  return ROUTE_EXACT;
+}
+
+/////////////////////////////////////////////////
+
 bool AsyncWebSocket::canHandle(AsyncWebServerRequest * request)
 {
   if (!_enabled)
@@ -1606,6 +2161,9 @@ bool AsyncWebSocket::canHandle(AsyncWebServerRequest * request)
   request->addInterestingHeader(WS_STR_KEY);
   request->addInterestingHeader(WS_STR_PROTOCOL);
 
+  if (_deflateEnabled)
+    request->addInterestingHeader(WS_STR_EXTENSIONS);
+
   return true;
 }
 
@@ -1637,7 +2195,19 @@ void AsyncWebSocket::handleRequest(AsyncWebServerRequest * request)
   }
 
   AsyncWebHeader* key = request->getHeader(WS_STR_KEY);
-  AsyncWebServerResponse *response = new AsyncWebSocketResponse(key->value(), this);
+  AsyncWebSocketResponse *response = new AsyncWebSocketResponse(key->value(), this);
+
+  if (_deflateEnabled && request->hasHeader(WS_STR_EXTENSIONS))
+  {
+    AwsDeflateParams params;
+    String extension;
+
+    if (_negotiateDeflate(request->getHeader(WS_STR_EXTENSIONS)->value(), params, extension))
+    {
+      response->addHeader(WS_STR_EXTENSIONS, extension);
+      response->_setDeflate(params);
+    }
+  }
 
   if (request->hasHeader(WS_STR_PROTOCOL))
   {
@@ -1651,6 +2221,172 @@ void AsyncWebSocket::handleRequest(AsyncWebServerRequest * request)
 
 /////////////////////////////////////////////////
 
+void AsyncWebSocket::enableDeflate(uint8_t windowBits, bool noContextTakeover)
+{
+  // 8 is legal but zlib based clients can't compress with it
+  _deflateWindowBits = std::min((uint8_t) 15, std::max((uint8_t) 9, windowBits));
+  _deflateNoContextTakeover = noContextTakeover;
+  _deflateEnabled = true;
+}
+
+/////////////////////////////////////////////////
+
+// Accept the first permessage-deflate offer in the Sec-WebSocket-Extensions header whose parameters
+// are all understood, RFC 7692 section 7.1. Fills the parameters and the extension to answer with
+bool AsyncWebSocket::_negotiateDeflate(const String& offers, AwsDeflateParams& params, String& response)
+{
+  int start = 0;
+
+  while (start < (int) offers.length())
+  {
+    int end = offers.indexOf(',', start);
+
+    if (end < 0)
+      end = offers.length();
+
+    String offer = offers.substring(start, end);
+    start = end + 1;
+
+    int paramStart = offer.indexOf(';');
+    String name = offer.substring(0, (paramStart < 0) ? offer.length() : paramStart);
+
+    name.trim();
+
+    if (!name.equalsIgnoreCase(WS_STR_DEFLATE))
+      continue;
+
+    bool valid               = true;
+    bool clientTakeover      = !_deflateNoContextTakeover;
+    bool clientBitsOffered   = false;
+    uint8_t serverWindowBits = _deflateWindowBits;
+    uint8_t clientWindowBits = _deflateWindowBits;
+    uint8_t seen             = 0;
+
+    while (valid && (paramStart >= 0))
+    {
+      int paramEnd = offer.indexOf(';', paramStart + 1);
+      String param = offer.substring(paramStart + 1, (paramEnd < 0) ? offer.length() : paramEnd);
+      String value;
+
+      paramStart = paramEnd;
+
+      int equals = param.indexOf('=');
+
+      if (equals >= 0)
+      {
+        value = param.substring(equals + 1);
+        param = param.substring(0, equals);
+
+        value.trim();
+        value.replace("\"", "");
+      }
+
+      param.trim();
+
+      long bits = value.length() ? value.toInt() : 0;
+      uint8_t flag;
+
+      if (param.equalsIgnoreCase("server_no_context_takeover") && !value.length())
+        flag = 0x01;
+      else if (param.equalsIgnoreCase("client_no_context_takeover") && !value.length())
+      {
+        flag = 0x02;
+        clientTakeover = false;
+      }
+      else if (param.equalsIgnoreCase("server_max_window_bits") && (bits >= 8) && (bits <= 15))
+      {
+        flag = 0x04;
+        serverWindowBits = std::min(serverWindowBits, (uint8_t) std::max(bits, 9L));
+
+        // Can't go below 9, see enableDeflate()
+        valid = (bits >= 9);
+      }
+      else if (param.equalsIgnoreCase("client_max_window_bits") && (!value.length() || ((bits >= 8) && (bits <= 15))))
+      {
+        flag = 0x08;
+        clientBitsOffered = true;
+
+        // With a value the client already limits its own window
+        if (value.length())
+          clientWindowBits = std::min(clientWindowBits, (uint8_t) bits);
+      }
+      else
+      {
+        // Unknown parameter or invalid value : decline this offer
+        flag = 0;
+        valid = false;
+      }
+
+      // Each parameter at most once
+      valid = valid && !(seen & flag);
+      seen |= flag;
+    }
+
+    if (!valid)
+      continue;
+
+    // Client history is bounded by our window only if the client accepts to use it,
+    // which it can only do when it offered client_max_window_bits
+    if (clientTakeover && (_deflateWindowBits < 15) && !clientBitsOffered)
+      clientTakeover = false;
+
+    params.enabled                 = true;
+    params.serverWindowBits        = serverWindowBits;
+    // The response can't answer more than the client offered, but zlib deflates with 9 when asked for 8 :
+    // the history kept is then one bit larger than negotiated, see enableDeflate()
+    params.clientWindowBits        = clientTakeover ? std::max(clientWindowBits, (uint8_t) 9) : 15;
+    params.clientNoContextTakeover = !clientTakeover;
+
+    response = WS_STR_DEFLATE;
+    response += "; server_no_context_takeover";
+
+    if (!clientTakeover)
+      response += "; client_no_context_takeover";
+
+    if (serverWindowBits < 15)
+    {
+      response += "; server_max_window_bits=";
+      response += serverWindowBits;
+    }
+
+    if (clientTakeover && clientBitsOffered && (clientWindowBits < 15))
+    {
+      response += "; client_max_window_bits=";
+      response += clientWindowBits;
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+/////////////////////////////////////////////////
+
+// Compress data into a new payload, or return NULL when it doesn't get any shorter
+AsyncWebSharedBuffer * AsyncWebSocket::_deflatePayload(const uint8_t * data, size_t len, uint8_t windowBits)
+{
+  AsyncWebSharedBuffer * payload = AsyncWebSharedBuffer::create(AsyncWebDeflate::bound(len), WS_FRAME_HEADER_MAX);
+
+  if (payload == NULL)
+    return NULL;
+
+  size_t deflatedLen = AsyncWebDeflate::compress(data, len, payload->data(), payload->length(), windowBits);
+
+  if ((deflatedLen == 0) || (deflatedLen >= len))
+  {
+    payload->unref();
+
+    return NULL;
+  }
+
+  payload->truncate(deflatedLen);
+
+  return payload;
+}
+
+/////////////////////////////////////////////////
+
 AsyncWebSocketMessageBuffer * AsyncWebSocket::makeBuffer(size_t size)
 {
   AsyncWebSocketMessageBuffer * buffer = new AsyncWebSocketMessageBuffer(size);
@@ -1685,13 +2421,10 @@ void AsyncWebSocket::_cleanBuffers()
 {
   AsyncWebLockGuard l(_lock);
 
-  for (AsyncWebSocketMessageBuffer * c : _buffers)
+  _buffers.remove_if([](AsyncWebSocketMessageBuffer * c)
   {
-    if (c && c->canDelete())
-    {
-      _buffers.remove(c);
-    }
-  }
+    return c && c->canDelete();
+  });
 }
 
 /////////////////////////////////////////////////
@@ -1715,6 +2448,8 @@ AsyncWebSocketResponse::AsyncWebSocketResponse(const String & key, AsyncWebSocke
   _code = 101;
   _sendContentLength = false;
 
+  memset(&_deflate, 0, sizeof(_deflate));
+
   uint8_t * hash = (uint8_t*) malloc(HASH_BUFFER_SIZE);
 
   if (hash == NULL)
@@ -1779,7 +2514,7 @@ size_t AsyncWebSocketResponse::_ack(AsyncWebServerRequest * request, size_t len,
 
   if (len)
   {
-    new AsyncWebSocketClient(request, _server);
+    new AsyncWebSocketClient(request, _server, &_deflate);
   }
 
   return 0;
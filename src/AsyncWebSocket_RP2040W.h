@@ -38,11 +38,58 @@
 // Longer queue takes longer time to process. If system is slow, longer queue is worse
 // Anyway any overflowed message will be discarded later
 // ESP32 using 8
-#define WS_MAX_QUEUED_MESSAGES 4
+// Default for AsyncWebSocket::setQueueLimits()
+#ifndef WS_MAX_QUEUED_MESSAGES
+  #define WS_MAX_QUEUED_MESSAGES    4
+#endif
+
+// Default byte budget of each client send queue. 0 => no byte limit
+#ifndef WS_MAX_QUEUED_BYTES
+  #define WS_MAX_QUEUED_BYTES       0
+#endif
+
+// Default for AsyncWebSocket::setQueuePolicy()
+#ifndef WS_QUEUE_POLICY
+  #define WS_QUEUE_POLICY           WS_QUEUE_DROP_OLDEST
+#endif
 
 //#define DEFAULT_MAX_WS_CLIENTS 8
 #define DEFAULT_MAX_WS_CLIENTS 4
 
+// Largest frame header (2 + 8 bytes of 64-bit length + 4 bytes of mask), rounded up to a word
+#define WS_FRAME_HEADER_MAX    16
+
+// RSV1 bit of the first header byte : marks the first frame of a permessage-deflate compressed message
+#define WS_FRAME_RSV1          0x40
+
+// permessage-deflate (RFC 7692), when enabled with AsyncWebSocket::enableDeflate()
+// LZ77 window, 9 to 15 bits. Bounds the history kept per client when it compresses with context takeover
+#ifndef WS_DEFLATE_WINDOW_BITS
+  #define WS_DEFLATE_WINDOW_BITS    15
+#endif
+
+// Shorter messages are sent uncompressed
+#ifndef WS_DEFLATE_MIN_SIZE
+  #define WS_DEFLATE_MIN_SIZE       64
+#endif
+
+// Longest message accepted from a client, compressed or once inflated. Longer ones close the connection (1009)
+#ifndef WS_DEFLATE_MAX_MESSAGE
+  #define WS_DEFLATE_MAX_MESSAGE    8192
+#endif
+
+// RFC 6455 limit for ping, pong and close payloads
+#define WS_MAX_CONTROL_PAYLOAD 125
+
+// Stack scratch used to send short frames in one piece and to mask payloads without
+// touching the caller's buffer. Must be a multiple of 4
+#ifndef WS_FRAME_SCRATCH_SIZE
+  #define WS_FRAME_SCRATCH_SIZE     256
+#endif
+
+// Masking works on whole 4 byte chunks of the scratch, anything else would send wrongly masked frames
+static_assert(((WS_FRAME_SCRATCH_SIZE % 4) == 0) && (WS_FRAME_SCRATCH_SIZE >= 4), "WS_FRAME_SCRATCH_SIZE must be a multiple of 4, at least 4");
+
 #include "AsyncWebSynchronization_RP2040W.h"
 
 class AsyncWebSocket;
@@ -79,6 +126,21 @@ typedef struct
 
 /////////////////////////////////////////////////
 
+// permessage-deflate parameters agreed with one client
+typedef struct
+{
+  /** Negotiated at all */
+  bool enabled;
+  /** LZ77 window used to compress server messages. Always without context takeover */
+  uint8_t serverWindowBits;
+  /** Window of the client's compressor, history kept when it uses context takeover */
+  uint8_t clientWindowBits;
+  /** Each client message is compressed on its own, no history to keep */
+  bool clientNoContextTakeover;
+} AwsDeflateParams;
+
+/////////////////////////////////////////////////
+
 typedef enum
 {
   WS_DISCONNECTED,
@@ -103,6 +165,16 @@ typedef enum
   WS_MSG_ERROR
 } AwsMessageStatus;
 
+// What a client send queue does with a message it has no room for. The message
+// at the head of the queue may be on the wire and is never dropped
+typedef enum
+{
+  WS_QUEUE_DROP_OLDEST,       // drop queued messages, oldest first, until it fits
+  WS_QUEUE_DROP_NEWEST,       // drop the new message
+  WS_QUEUE_COALESCE,          // drop the queued message with the same key, else as WS_QUEUE_DROP_OLDEST
+  WS_QUEUE_DISCONNECT         // drop the new message and the queue, and close the client (1008)
+} AwsQueuePolicy;
+
 typedef enum
 {
   WS_EVT_CONNECT,
@@ -117,10 +189,11 @@ typedef enum
 class AsyncWebSocketMessageBuffer
 {
   private:
-    uint8_t * _data;
-    size_t _len;
+    // Has room in front of the data for the frame header of a broadcast, built once for all clients
+    AsyncWebSharedBuffer * _payload;
     bool _lock;
     uint32_t _count;
+    uint32_t _key;
 
   public:
     AsyncWebSocketMessageBuffer();
@@ -172,14 +245,22 @@ class AsyncWebSocketMessageBuffer
 
     inline uint8_t * get()
     {
-      return _data;
+      return _payload ? _payload->data() : NULL;
     }
 
     /////////////////////////////////////////////////
 
     inline size_t length()
     {
-      return _len;
+      return _payload ? _payload->length() : 0;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Messages queued from this buffer hold their own reference : reserve() may replace it
+    inline AsyncWebSharedBuffer * payload()
+    {
+      return _payload;
     }
 
     /////////////////////////////////////////////////
@@ -198,21 +279,37 @@ class AsyncWebSocketMessageBuffer
 
     /////////////////////////////////////////////////
 
+    // Messages made from this buffer get the key, see WS_QUEUE_COALESCE. 0 => no key
+    inline void setKey(uint32_t key)
+    {
+      _key = key;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline uint32_t key() const
+    {
+      return _key;
+    }
+
+    /////////////////////////////////////////////////
+
     friend AsyncWebSocket;
 
 };
 
 /////////////////////////////////////////////////
 
-class AsyncWebSocketMessage
+class AsyncWebSocketMessage : public LinkedListHook<AsyncWebSocketMessage>
 {
   protected:
     uint8_t _opcode;
     bool _mask;
     AwsMessageStatus _status;
+    uint32_t _key;
 
   public:
-    AsyncWebSocketMessage(): _opcode(WS_TEXT), _mask(false), _status(WS_MSG_ERROR) {}
+    AsyncWebSocketMessage(): _opcode(WS_TEXT), _mask(false), _status(WS_MSG_ERROR), _key(0) {}
     virtual ~AsyncWebSocketMessage() {}
     virtual void ack(size_t len __attribute__((unused)), uint32_t time __attribute__((unused))) {}
 
@@ -236,6 +333,29 @@ class AsyncWebSocketMessage
     {
       return false;
     }
+
+    /////////////////////////////////////////////////
+
+    // Payload bytes, counted against the queue byte budget
+    virtual size_t length() const
+    {
+      return 0;
+    }
+
+    /////////////////////////////////////////////////
+
+    // A newer message with the same key may replace this one while it waits, see WS_QUEUE_COALESCE. 0 => no key
+    inline void setKey(uint32_t key)
+    {
+      _key = key;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline uint32_t key() const
+    {
+      return _key;
+    }
 };
 
 /////////////////////////////////////////////////
@@ -263,6 +383,13 @@ class AsyncWebSocketBasicMessage: public AsyncWebSocketMessage
 
     /////////////////////////////////////////////////
 
+    virtual size_t length() const override
+    {
+      return _len;
+    }
+
+    /////////////////////////////////////////////////
+
     virtual void ack(size_t len, uint32_t time) override;
     virtual size_t send(AsyncClient *client) override;
 };
@@ -272,6 +399,7 @@ class AsyncWebSocketBasicMessage: public AsyncWebSocketMessage
 class AsyncWebSocketMultiMessage: public AsyncWebSocketMessage
 {
   private:
+    AsyncWebSharedBuffer * _payload;
     uint8_t * _data;
     size_t _len;
     size_t _sent;
@@ -281,6 +409,7 @@ class AsyncWebSocketMultiMessage: public AsyncWebSocketMessage
 
   public:
     AsyncWebSocketMultiMessage(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode = WS_TEXT, bool mask = false);
+    AsyncWebSocketMultiMessage(AsyncWebSharedBuffer * payload, uint8_t opcode = WS_TEXT, bool mask = false);
     virtual ~AsyncWebSocketMultiMessage() override;
 
     /////////////////////////////////////////////////
@@ -292,6 +421,13 @@ class AsyncWebSocketMultiMessage: public AsyncWebSocketMessage
 
     /////////////////////////////////////////////////
 
+    virtual size_t length() const override
+    {
+      return _len;
+    }
+
+    /////////////////////////////////////////////////
+
     virtual void ack(size_t len, uint32_t time) override ;
     virtual size_t send(AsyncClient *client) override ;
 };
@@ -306,23 +442,53 @@ class AsyncWebSocketClient
     uint32_t _clientId;
     AwsClientStatus _status;
 
-    LinkedList<AsyncWebSocketControl *> _controlQueue;
-    LinkedList<AsyncWebSocketMessage *> _messageQueue;
+    IntrusiveLinkedList<AsyncWebSocketControl> _controlQueue;
+    IntrusiveLinkedList<AsyncWebSocketMessage> _messageQueue;
 
-    uint8_t _pstate;
+    uint8_t _pstate;              // 0 : expecting a frame header, 1 : in a payload, 2 : failed, input ignored
     AwsFrameInfo _pinfo;
 
+    // Frame header bytes received so far when a header straddles TCP segments
+    uint8_t _pheader[WS_FRAME_HEADER_MAX];
+    uint8_t _pheaderLen;
+
+    // Payload of a control frame split across TCP segments, plus a null terminator
+    uint8_t _pcontrol[WS_MAX_CONTROL_PAYLOAD + 1];
+
+    void _parseFrameHeader(const uint8_t *header);
+    void _failConnection(uint16_t code);
+
+    // permessage-deflate
+    AwsDeflateParams _deflate;
+    bool _pdeflated;              // the message being received is compressed
+    uint8_t * _inflateData;       // its compressed payload so far
+    size_t _inflateLen;
+    uint8_t * _inflateHistory;    // last bytes of the previous messages, with client context takeover
+    size_t _inflateHistoryLen;
+
+    void _inflateAppend(const uint8_t *data, size_t len);
+    void _inflateMessage();
+
     uint32_t _lastMessageTime;
     uint32_t _keepAlivePeriod;
 
+    size_t _queuedBytes;
+    uint32_t _droppedMessages;
+    uint32_t _coalescedMessages;
+
+    bool _makeQueueRoom(AsyncWebSocketMessage *dataMessage);
+    void _dropQueued(AsyncWebSocketMessage *dataMessage);
     void _queueMessage(AsyncWebSocketMessage *dataMessage);
     void _queueControl(AsyncWebSocketControl *controlMessage);
+    void _queueData(const char * data, size_t len, uint8_t opcode);
+    void _queueBuffer(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode);
+    void _queuePayload(AsyncWebSharedBuffer * payload, uint8_t opcode);
     void _runQueue();
 
   public:
     void *_tempObject;
 
-    AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server);
+    AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server, const AwsDeflateParams *deflate = NULL);
     ~AsyncWebSocketClient();
 
     /////////////////////////////////////////////////
@@ -363,6 +529,13 @@ class AsyncWebSocketClient
 
     /////////////////////////////////////////////////
 
+    inline AwsDeflateParams const &deflateParams() const
+    {
+      return _deflate;
+    }
+
+    /////////////////////////////////////////////////
+
     IPAddress remoteIP();
     uint16_t  remotePort();
 
@@ -398,6 +571,7 @@ class AsyncWebSocketClient
     bool queueIsFull();
 
     size_t printf(const char *format, ...)  __attribute__ ((format (printf, 2, 3)));
+    size_t vprintf(const char *format, va_list arg);
 
     void text(const char * message, size_t len);
     void text(const char * message);
@@ -415,9 +589,37 @@ class AsyncWebSocketClient
 
     /////////////////////////////////////////////////
 
-    inline bool canSend()
+    bool canSend();
+
+    /////////////////////////////////////////////////
+
+    inline size_t queueLength() const
     {
-      return _messageQueue.length() < WS_MAX_QUEUED_MESSAGES;
+      return _messageQueue.length();
+    }
+
+    /////////////////////////////////////////////////
+
+    // Payload bytes of the queued messages, the one being sent included
+    inline size_t queuedBytes() const
+    {
+      return _queuedBytes;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Messages lost to the queue policy, coalesced ones excluded
+    inline uint32_t droppedMessages() const
+    {
+      return _droppedMessages;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Messages replaced by a newer one with the same key
+    inline uint32_t coalescedMessages() const
+    {
+      return _coalescedMessages;
     }
 
     /////////////////////////////////////////////////
@@ -452,6 +654,17 @@ class AsyncWebSocket: public AsyncWebHandler
     bool _enabled;
     AsyncWebLock _lock;
 
+    bool _deflateEnabled;
+    uint8_t _deflateWindowBits;
+    bool _deflateNoContextTakeover;
+
+    size_t _queueMaxMessages;
+    size_t _queueMaxBytes;
+    AwsQueuePolicy _queuePolicy;
+
+    bool _negotiateDeflate(const String& offers, AwsDeflateParams& params, String& response);
+    void _bufferAll(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode);
+
   public:
     AsyncWebSocket(const String& url);
     ~AsyncWebSocket();
@@ -479,6 +692,64 @@ class AsyncWebSocket: public AsyncWebHandler
 
     /////////////////////////////////////////////////
 
+    // Offer permessage-deflate (RFC 7692) to new clients. Server messages are always compressed
+    // without context takeover, so that a broadcast is compressed once for all clients.
+    // noContextTakeover also asks clients to compress each message on its own : no per-client
+    // history, otherwise up to 2^windowBits bytes per client
+    void enableDeflate(uint8_t windowBits = WS_DEFLATE_WINDOW_BITS, bool noContextTakeover = true);
+
+    inline void disableDeflate()
+    {
+      _deflateEnabled = false;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline bool deflateEnabled() const
+    {
+      return _deflateEnabled;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Per client send queue limits. maxBytes 0 => no byte limit. A message longer than maxBytes
+    // is still queued when the client has nothing else queued
+    inline void setQueueLimits(size_t maxMessages, size_t maxBytes = WS_MAX_QUEUED_BYTES)
+    {
+      _queueMaxMessages = maxMessages ? maxMessages : 1;
+      _queueMaxBytes    = maxBytes;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline size_t queueMaxMessages() const
+    {
+      return _queueMaxMessages;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline size_t queueMaxBytes() const
+    {
+      return _queueMaxBytes;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline void setQueuePolicy(AwsQueuePolicy policy)
+    {
+      _queuePolicy = policy;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline AwsQueuePolicy queuePolicy() const
+    {
+      return _queuePolicy;
+    }
+
+    /////////////////////////////////////////////////
+
     bool availableForWriteAll();
     bool availableForWrite(uint32_t id);
 
@@ -555,6 +826,7 @@ class AsyncWebSocket: public AsyncWebHandler
     void _handleDisconnect(AsyncWebSocketClient * client);
     void _handleEvent(AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len);
     virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual WebRouteType route(String& pattern, WebRequestMethodComposite& methods) override final;
     virtual void handleRequest(AsyncWebServerRequest *request) override final;
 
     //  messagebuffer functions/objects.
@@ -562,6 +834,7 @@ class AsyncWebSocket: public AsyncWebHandler
     AsyncWebSocketMessageBuffer * makeBuffer(uint8_t * data, size_t size);
     LinkedList<AsyncWebSocketMessageBuffer *> _buffers;
     void _cleanBuffers();
+    AsyncWebSharedBuffer * _deflatePayload(const uint8_t * data, size_t len, uint8_t windowBits);
 
     AsyncWebSocketClientLinkedList getClients() const;
 };
@@ -574,9 +847,18 @@ class AsyncWebSocketResponse: public AsyncWebServerResponse
   private:
     String _content;
     AsyncWebSocket *_server;
+    AwsDeflateParams _deflate;
 
   public:
     AsyncWebSocketResponse(const String& key, AsyncWebSocket *server);
+
+    /////////////////////////////////////////////////
+
+    inline void _setDeflate(const AwsDeflateParams& params)
+    {
+      _deflate = params;
+    }
+
     void _respond(AsyncWebServerRequest *request);
     size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
 
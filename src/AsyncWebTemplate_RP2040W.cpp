@@ -0,0 +1,212 @@
+/****************************************************************************************************************************
+  AsyncWebTemplate_RP2040W.cpp
+
+  For RP2040W with CYW43439 WiFi
+
+  AsyncWebServer_RP2040W is a library for the RP2040W with CYW43439 WiFi
+
+  Based on and modified from ESPAsyncWebServer (https://github.com/me-no-dev/ESPAsyncWebServer)
+  Built by Khoi Hoang https://github.com/khoih-prog/AsyncWebServer_RP2040W
+  Licensed under GPLv3 license
+
+  Version: 1.5.0
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      13/08/2022 Initial coding for RP2040W with CYW43439 WiFi
+  ...
+  1.3.0   K Hoang      10/10/2022 Fix crash when using AsyncWebSockets server
+  1.3.1   K Hoang      10/10/2022 Improve robustness of AsyncWebSockets server
+  1.4.0   K Hoang      20/10/2022 Add LittleFS functions such as AsyncFSWebServer
+  1.4.1   K Hoang      10/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.4.2   K Hoang      28/01/2023 Add Async_AdvancedWebServer_SendChunked_MQTT and AsyncWebServer_MQTT_RP2040W examples
+  1.5.0   K Hoang      30/01/2023 Fix _catchAllHandler not working bug
+ *****************************************************************************************************************************/
+
+#if !defined(_RP2040W_AWS_LOGLEVEL_)
+  #define _RP2040W_AWS_LOGLEVEL_     1
+#endif
+
+/////////////////////////////////////////////////
+
+#include "AsyncWebServer_RP2040W_Debug.h"
+
+#include "AsyncWebServer_RP2040W.h"
+#include "AsyncWebResponseImpl_RP2040W.h"
+
+/////////////////////////////////////////////////
+
+AsyncWebTemplate::AsyncWebTemplate(const String& key, size_t size, time_t stamp)
+  : _key(key), _size(size), _stamp(stamp), _refs(1), _used(0), _cached(false), _open(SIZE_MAX), _nameLength(0)
+{
+}
+
+/////////////////////////////////////////////////
+
+// Scan the next len bytes of the content, at offset. Placeholders may be split between two calls
+void AsyncWebTemplate::_scan(const uint8_t* data, size_t len, size_t offset)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    const char c = data[i];
+
+    if (_open == SIZE_MAX)
+    {
+      if (c == TEMPLATE_PLACEHOLDER)
+      {
+        _open = offset + i;
+        _nameLength = 0;
+      }
+    }
+    else if (c == TEMPLATE_PLACEHOLDER)
+    {
+      _name[_nameLength] = 0;
+      _placeholders.push_back({ _open, (uint8_t) (_nameLength + 2), String(_name) });
+      _open = SIZE_MAX;
+    }
+    else if (_nameLength == TEMPLATE_PARAM_NAME_LENGTH)
+    {
+      // Too long for a name, the opening TEMPLATE_PLACEHOLDER is sent as is
+      _open = SIZE_MAX;
+    }
+    else
+    {
+      _name[_nameLength++] = c;
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+
+std::vector<AsyncWebTemplate*>& AsyncWebTemplate::_cache()
+{
+  static std::vector<AsyncWebTemplate*> cache;
+
+  return cache;
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebTemplate* AsyncWebTemplate::_find(const String& key, size_t size, time_t stamp)
+{
+  static uint32_t use = 0;
+
+  auto& cache = _cache();
+
+  for (auto it = cache.begin(); it != cache.end(); it++)
+  {
+    AsyncWebTemplate* tmpl = *it;
+
+    if (tmpl->_key != key)
+      continue;
+
+    if (tmpl->_size == size && tmpl->_stamp == stamp)
+    {
+      tmpl->_refs++;
+      tmpl->_used = ++use;
+
+      return tmpl;
+    }
+
+    // Content changed, responses still sending the old one delete it when done
+    cache.erase(it);
+    tmpl->_cached = false;
+
+    if (!tmpl->_refs)
+      delete tmpl;
+
+    break;
+  }
+
+  return nullptr;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebTemplate::_insert(AsyncWebTemplate* tmpl)
+{
+  auto& cache = _cache();
+
+  if (cache.size() >= TEMPLATE_CACHE_SIZE)
+  {
+    // Drop the least recently used template no response is using, if any
+    auto lru = cache.end();
+
+    for (auto it = cache.begin(); it != cache.end(); it++)
+    {
+      if (!(*it)->_refs && (lru == cache.end() || (*it)->_used < (*lru)->_used))
+        lru = it;
+    }
+
+    if (lru == cache.end())
+      return;
+
+    delete *lru;
+    cache.erase(lru);
+  }
+
+  tmpl->_cached = true;
+  cache.push_back(tmpl);
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebTemplate* AsyncWebTemplate::fromFile(File& file, const String& path)
+{
+  const size_t size  = file.size();
+  const time_t stamp = file.getLastWrite();
+
+  AsyncWebTemplate* tmpl = _find(path, size, stamp);
+
+  if (tmpl)
+    return tmpl;
+
+  AWS_LOGDEBUG1("AsyncWebTemplate::fromFile: scanning ", path);
+
+  tmpl = new AsyncWebTemplate(path, size, stamp);
+
+  uint8_t buf[128];
+  size_t offset = 0;
+  size_t len;
+
+  while ((len = file.read(buf, sizeof(buf))) > 0)
+  {
+    tmpl->_scan(buf, len, offset);
+    offset += len;
+  }
+
+  file.seek(0, SeekSet);
+
+  _insert(tmpl);
+
+  return tmpl;
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebTemplate* AsyncWebTemplate::fromProgmem(const uint8_t* content, size_t len)
+{
+  char key[20];
+
+  snprintf(key, sizeof(key), "P:%lx", (unsigned long) (uintptr_t) content);
+
+  AsyncWebTemplate* tmpl = _find(key, len, 0);
+
+  if (tmpl)
+    return tmpl;
+
+  tmpl = new AsyncWebTemplate(key, len, 0);
+  tmpl->_scan(content, len, 0);
+
+  _insert(tmpl);
+
+  return tmpl;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebTemplate::release(AsyncWebTemplate* tmpl)
+{
+  if (tmpl && --tmpl->_refs == 0 && !tmpl->_cached)
+    delete tmpl;
+}
@@ -0,0 +1,185 @@
+/****************************************************************************************************************************
+  AsyncWebUploadSink_RP2040W.cpp
+
+  For RP2040W with CYW43439 WiFi
+
+  AsyncWebServer_RP2040W is a library for the RP2040W with CYW43439 WiFi
+
+  Based on and modified from ESPAsyncWebServer (https://github.com/me-no-dev/ESPAsyncWebServer)
+  Built by Khoi Hoang https://github.com/khoih-prog/AsyncWebServer_RP2040W
+  Licensed under GPLv3 license
+
+  Version: 1.5.0
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      13/08/2022 Initial coding for RP2040W with CYW43439 WiFi
+  ...
+  1.3.0   K Hoang      10/10/2022 Fix crash when using AsyncWebSockets server
+  1.3.1   K Hoang      10/10/2022 Improve robustness of AsyncWebSockets server
+  1.4.0   K Hoang      20/10/2022 Add LittleFS functions such as AsyncFSWebServer
+  1.4.1   K Hoang      10/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.4.2   K Hoang      28/01/2023 Add Async_AdvancedWebServer_SendChunked_MQTT and AsyncWebServer_MQTT_RP2040W examples
+  1.5.0   K Hoang      30/01/2023 Fix _catchAllHandler not working bug
+ *****************************************************************************************************************************/
+
+#if !defined(_RP2040W_AWS_LOGLEVEL_)
+  #define _RP2040W_AWS_LOGLEVEL_     1
+#endif
+
+/////////////////////////////////////////////////
+
+#include "AsyncWebServer_RP2040W_Debug.h"
+
+#include "AsyncWebServer_RP2040W.h"
+
+/////////////////////////////////////////////////
+
+AsyncWebUploadSink::AsyncWebUploadSink(AwsUploadSinkWriter writer, AwsUploadSinkEnd onEnd, size_t blockSize)
+  : _writer(writer), _onEnd(onEnd), _blockSize(blockSize ? blockSize : UPLOAD_SINK_BLOCK_SIZE), _head(0), _count(0)
+  , _readPos(0), _fill(0), _queued(0), _written(0), _final(false), _ended(false), _failed(false)
+{
+  memset(_blocks, 0, sizeof(_blocks));
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebUploadSink::~AsyncWebUploadSink()
+{
+  if (!_ended)
+    _end(false);
+
+  for (uint8_t i = 0; i < UPLOAD_SINK_BLOCKS; i++)
+  {
+    if (_blocks[i])
+      free(_blocks[i]);
+  }
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebUploadSink::_end(bool success)
+{
+  _ended = true;
+  _failed = !success;
+
+  // What is still queued won't be written
+  _queued = 0;
+  _count = 0;
+
+  if (_onEnd)
+    _onEnd(success, _written);
+}
+
+/////////////////////////////////////////////////
+
+size_t AsyncWebUploadSink::push(const uint8_t *data, size_t len)
+{
+  if (_ended)
+    return len;
+
+  size_t pushed = 0;
+
+  while (pushed < len)
+  {
+    if (!_count || (_fill == _blockSize))
+    {
+      if (_count == UPLOAD_SINK_BLOCKS)
+        break;
+
+      uint8_t tail = (_head + _count) % UPLOAD_SINK_BLOCKS;
+
+      if (!_blocks[tail])
+      {
+        _blocks[tail] = (uint8_t *) malloc(_blockSize);
+
+        if (!_blocks[tail])
+        {
+          AWS_LOGERROR1("AsyncWebUploadSink::push: no memory for block, size =", _blockSize);
+
+          break;
+        }
+      }
+
+      _count++;
+      _fill = 0;
+    }
+
+    uint8_t* block = _blocks[(_head + _count - 1) % UPLOAD_SINK_BLOCKS];
+    size_t n = _blockSize - _fill;
+
+    if (n > len - pushed)
+      n = len - pushed;
+
+    memcpy(block + _fill, data + pushed, n);
+    _fill += n;
+    pushed += n;
+  }
+
+  _queued += pushed;
+
+  return pushed;
+}
+
+/////////////////////////////////////////////////
+
+size_t AsyncWebUploadSink::flush()
+{
+  size_t total = 0;
+
+  while (_count && !_ended)
+  {
+    size_t blockLen = (_count == 1) ? _fill : _blockSize;
+
+    // Only the last block of the file is written partly filled
+    if ((blockLen < _blockSize) && !_final)
+      break;
+
+    size_t len = blockLen - _readPos;
+    size_t n = len ? _writer(_blocks[_head] + _readPos, len) : 0;
+
+    if (n == UPLOAD_SINK_ERROR)
+    {
+      AWS_LOGERROR1("AsyncWebUploadSink::flush: write failed, written =", _written);
+
+      _end(false);
+
+      break;
+    }
+
+    if (n > len)
+      n = len;
+
+    _readPos += n;
+    _queued -= n;
+    _written += n;
+    total += n;
+
+    if (_readPos < blockLen)
+      break;
+
+    _head = (_head + 1) % UPLOAD_SINK_BLOCKS;
+    _count--;
+    _readPos = 0;
+  }
+
+  if (_final && !_queued && !_ended)
+    _end(true);
+
+  return total;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebUploadSink::finish()
+{
+  _final = true;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebUploadSink::abort()
+{
+  if (!_ended)
+    _end(false);
+}
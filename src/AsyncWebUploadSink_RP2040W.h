@@ -0,0 +1,134 @@
+/****************************************************************************************************************************
+  AsyncWebUploadSink_RP2040W.h
+
+  For RP2040W with CYW43439 WiFi
+
+  AsyncWebServer_RP2040W is a library for the RP2040W with CYW43439 WiFi
+
+  Based on and modified from ESPAsyncWebServer (https://github.com/me-no-dev/ESPAsyncWebServer)
+  Built by Khoi Hoang https://github.com/khoih-prog/AsyncWebServer_RP2040W
+  Licensed under GPLv3 license
+
+  Version: 1.5.0
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      13/08/2022 Initial coding for RP2040W with CYW43439 WiFi
+  ...
+  1.3.0   K Hoang      10/10/2022 Fix crash when using AsyncWebSockets server
+  1.3.1   K Hoang      10/10/2022 Improve robustness of AsyncWebSockets server
+  1.4.0   K Hoang      20/10/2022 Add LittleFS functions such as AsyncFSWebServer
+  1.4.1   K Hoang      10/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.4.2   K Hoang      28/01/2023 Add Async_AdvancedWebServer_SendChunked_MQTT and AsyncWebServer_MQTT_RP2040W examples
+  1.5.0   K Hoang      30/01/2023 Fix _catchAllHandler not working bug
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef RP2040W_ASYNCWEBUPLOADSINK_H_
+#define RP2040W_ASYNCWEBUPLOADSINK_H_
+
+#include "Arduino.h"
+#include <functional>
+
+/////////////////////////////////////////////////
+
+// Size of each write to the sink : LittleFS block / flash sector size on the RP2040
+#ifndef UPLOAD_SINK_BLOCK_SIZE
+  #define UPLOAD_SINK_BLOCK_SIZE        4096
+#endif
+
+// Blocks queued before the TCP window closes. Keep the total above TCP_WND (8 * TCP_MSS by default)
+#ifndef UPLOAD_SINK_BLOCKS
+  #define UPLOAD_SINK_BLOCKS            4
+#endif
+
+// Returned by a writer that can't take any more data, the upload is aborted
+#define UPLOAD_SINK_ERROR               ((size_t) -1)
+
+/////////////////////////////////////////////////
+
+// Write up to len bytes and return how many were written. Less than len, even 0, means busy :
+// the rest stays queued and is offered again later
+typedef std::function<size_t(uint8_t *data, size_t len)> AwsUploadSinkWriter;
+
+// Called once, with the bytes written, after the last write or when the upload is aborted
+typedef std::function<void(bool success, size_t size)> AwsUploadSinkEnd;
+
+/////////////////////////////////////////////////
+
+/*
+   UPLOAD SINK :: Bounded queue of blocks between the received upload data and its writer.
+   Data is written in whole blocks, aligned on the start of the file, and only the last block can be partial
+ * */
+
+class AsyncWebUploadSink
+{
+  private:
+    AwsUploadSinkWriter _writer;
+    AwsUploadSinkEnd    _onEnd;
+    size_t   _blockSize;
+    uint8_t* _blocks[UPLOAD_SINK_BLOCKS];   // allocated when first needed, reused after being written
+    uint8_t  _head;       // block being written
+    uint8_t  _count;      // blocks holding queued data, the last one may be partly filled
+    size_t   _readPos;    // bytes of the head block already written
+    size_t   _fill;       // bytes in the last block
+    size_t   _queued;
+    size_t   _written;
+    bool     _final;      // no more data, the last block is written even if partial
+    bool     _ended;
+    bool     _failed;
+
+    void _end(bool success);
+
+  public:
+    AsyncWebUploadSink(AwsUploadSinkWriter writer, AwsUploadSinkEnd onEnd = nullptr,
+                       size_t blockSize = UPLOAD_SINK_BLOCK_SIZE);
+    ~AsyncWebUploadSink();
+
+    AsyncWebUploadSink(const AsyncWebUploadSink &) = delete;
+    AsyncWebUploadSink &operator=(const AsyncWebUploadSink &) = delete;
+
+    // Queue up to len bytes, return how many were queued. Data pushed after a failure is dropped
+    size_t push(const uint8_t *data, size_t len);
+
+    // Write the full blocks, or everything after finish(), until the writer is busy. Return the bytes written
+    size_t flush();
+
+    void finish();
+    void abort();
+
+    /////////////////////////////////////////////////
+
+    // Received but not written yet
+    inline size_t queued() const
+    {
+      return _queued;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline size_t written() const
+    {
+      return _written;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Everything written, or aborted
+    inline bool done() const
+    {
+      return _ended;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline bool failed() const
+    {
+      return _failed;
+    }
+};
+
+/////////////////////////////////////////////////
+
+#endif    // RP2040W_ASYNCWEBUPLOADSINK_H_
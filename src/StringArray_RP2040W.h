@@ -71,8 +71,37 @@ class LinkedList
 
   private:
     ItemType* _root;
+    ItemType* _last;      // O(1) add()
+    size_t    _count;     // O(1) length()
     OnRemove _onRemove;
 
+    /////////////////////////////////////////////////
+
+    // Unlink it (pit is the node before it, or it itself for the root) and destroy it
+    void _unlink(ItemType* it, ItemType* pit)
+    {
+      if (it == _root)
+      {
+        _root = _root->next;
+      }
+      else
+      {
+        pit->next = it->next;
+      }
+
+      if (it == _last)
+        _last = (it == _root || !_root) ? nullptr : pit;
+
+      _count--;
+
+      if (_onRemove)
+      {
+        _onRemove(it->value());
+      }
+
+      delete it;
+    }
+
     class Iterator
     {
         ItemType* _node;
@@ -131,7 +160,7 @@ class LinkedList
 
     /////////////////////////////////////////////////
 
-    LinkedList(OnRemove onRemove) : _root(nullptr), _onRemove(onRemove) {}
+    LinkedList(OnRemove onRemove) : _root(nullptr), _last(nullptr), _count(0), _onRemove(onRemove) {}
 
     /////////////////////////////////////////////////
 
@@ -149,13 +178,11 @@ class LinkedList
       }
       else
       {
-        auto i = _root;
-
-        while (i->next)
-          i = i->next;
-
-        i->next = it;
+        _last->next = it;
       }
+
+      _last = it;
+      _count++;
     }
 
     /////////////////////////////////////////////////
@@ -174,18 +201,9 @@ class LinkedList
 
     /////////////////////////////////////////////////
 
-    size_t length() const
+    inline size_t length() const
     {
-      size_t i = 0;
-      auto it = _root;
-
-      while (it)
-      {
-        i++;
-        it = it->next;
-      }
-
-      return i;
+      return _count;
     }
 
     /////////////////////////////////////////////////
@@ -241,21 +259,7 @@ class LinkedList
       {
         if (it->value() == t)
         {
-          if (it == _root)
-          {
-            _root = _root->next;
-          }
-          else
-          {
-            pit->next = it->next;
-          }
-
-          if (_onRemove)
-          {
-            _onRemove(it->value());
-          }
-
-          delete it;
+          _unlink(it, pit);
 
           return true;
         }
@@ -278,21 +282,7 @@ class LinkedList
       {
         if (predicate(it->value()))
         {
-          if (it == _root)
-          {
-            _root = _root->next;
-          }
-          else
-          {
-            pit->next = it->next;
-          }
-
-          if (_onRemove)
-          {
-            _onRemove(it->value());
-          }
-
-          delete it;
+          _unlink(it, pit);
 
           return true;
         }
@@ -306,6 +296,38 @@ class LinkedList
 
     /////////////////////////////////////////////////
 
+    // Remove all matching items, safe unlike remove() while iterating
+    size_t remove_if(Predicate predicate)
+    {
+      size_t removed = 0;
+      auto it = _root;
+      auto pit = _root;
+
+      while (it)
+      {
+        auto next = it->next;
+
+        if (predicate(it->value()))
+        {
+          _unlink(it, pit);
+          removed++;
+
+          if (pit == it)
+            pit = next;
+        }
+        else
+        {
+          pit = it;
+        }
+
+        it = next;
+      }
+
+      return removed;
+    }
+
+    /////////////////////////////////////////////////
+
     void free()
     {
       while (_root != nullptr)
@@ -321,7 +343,300 @@ class LinkedList
         delete it;
       }
 
-      _root = nullptr;
+      _root   = nullptr;
+      _last   = nullptr;
+      _count  = 0;
+    }
+};
+
+/////////////////////////////////////////////////
+/////////////////////////////////////////////////
+
+/*
+   Intrusive list : the objects carry their own link, so add() doesn't allocate a node.
+   T has to derive from LinkedListHook<T>, and can only be in one IntrusiveLinkedList at a time.
+   Same API as LinkedList<T*>
+ * */
+
+template <typename T>
+class LinkedListHook
+{
+  public:
+    T* _listNext;
+
+    LinkedListHook() : _listNext(nullptr) {}
+
+    // A copy is not in any list
+    LinkedListHook(const LinkedListHook&) : _listNext(nullptr) {}
+
+    /////////////////////////////////////////////////
+
+    inline LinkedListHook& operator = (const LinkedListHook&)
+    {
+      return *this;
+    }
+};
+
+/////////////////////////////////////////////////
+
+template <typename T>
+class IntrusiveLinkedList
+{
+  public:
+    typedef T* ValueType;
+    typedef std::function<void(T* const&)> OnRemove;
+    typedef std::function<bool(T* const&)> Predicate;
+
+  private:
+    T*      _root;
+    T*      _last;
+    size_t  _count;
+    OnRemove _onRemove;
+
+    class Iterator
+    {
+        T* _node;
+
+      public:
+        Iterator(T* current = nullptr) : _node(current) {}
+        Iterator(const Iterator& i) : _node(i._node) {}
+
+        /////////////////////////////////////////////////
+
+        inline Iterator& operator ++()
+        {
+          _node = _node->_listNext;
+
+          return *this;
+        }
+
+        /////////////////////////////////////////////////
+
+        inline bool operator != (const Iterator& i) const
+        {
+          return _node != i._node;
+        }
+
+        /////////////////////////////////////////////////
+
+        inline T* operator * () const
+        {
+          return _node;
+        }
+    };
+
+    /////////////////////////////////////////////////
+
+    // Unlink it (pit is the item before it, or it itself for the root) and hand it to _onRemove
+    void _unlink(T* it, T* pit)
+    {
+      if (it == _root)
+      {
+        _root = _root->_listNext;
+      }
+      else
+      {
+        pit->_listNext = it->_listNext;
+      }
+
+      if (it == _last)
+        _last = (it == _root || !_root) ? nullptr : pit;
+
+      it->_listNext = nullptr;
+      _count--;
+
+      if (_onRemove)
+      {
+        _onRemove(it);
+      }
+    }
+
+  public:
+    typedef const Iterator ConstIterator;
+
+    /////////////////////////////////////////////////
+
+    inline ConstIterator begin() const
+    {
+      return ConstIterator(_root);
+    }
+
+    /////////////////////////////////////////////////
+
+    inline ConstIterator end() const
+    {
+      return ConstIterator(nullptr);
+    }
+
+    /////////////////////////////////////////////////
+
+    IntrusiveLinkedList(OnRemove onRemove) : _root(nullptr), _last(nullptr), _count(0), _onRemove(onRemove) {}
+
+    /////////////////////////////////////////////////
+
+    ~IntrusiveLinkedList() {}
+
+    /////////////////////////////////////////////////
+
+    void add(T* t)
+    {
+      t->_listNext = nullptr;
+
+      if (!_root)
+      {
+        _root = t;
+      }
+      else
+      {
+        _last->_listNext = t;
+      }
+
+      _last = t;
+      _count++;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline T* front() const
+    {
+      return _root;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline bool isEmpty() const
+    {
+      return _root == nullptr;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline size_t length() const
+    {
+      return _count;
+    }
+
+    /////////////////////////////////////////////////
+
+    size_t count_if(Predicate predicate) const
+    {
+      size_t i = 0;
+
+      for (T* it = _root; it; it = it->_listNext)
+      {
+        if (!predicate || predicate(it))
+          i++;
+      }
+
+      return i;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Pointer to the link holding the Nth item, as LinkedList<T*>::nth()
+    T* const* nth(size_t N) const
+    {
+      T* const* link = &_root;
+
+      while (*link)
+      {
+        if (N-- == 0)
+          return link;
+
+        link = &((*link)->_listNext);
+      }
+
+      return nullptr;
+    }
+
+    /////////////////////////////////////////////////
+
+    bool remove(T* t)
+    {
+      T* pit = _root;
+
+      for (T* it = _root; it; pit = it, it = it->_listNext)
+      {
+        if (it == t)
+        {
+          _unlink(it, pit);
+
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    /////////////////////////////////////////////////
+
+    bool remove_first(Predicate predicate)
+    {
+      T* pit = _root;
+
+      for (T* it = _root; it; pit = it, it = it->_listNext)
+      {
+        if (predicate(it))
+        {
+          _unlink(it, pit);
+
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Remove all matching items, safe unlike remove() while iterating
+    size_t remove_if(Predicate predicate)
+    {
+      size_t removed = 0;
+      T* it  = _root;
+      T* pit = _root;
+
+      while (it)
+      {
+        T* next = it->_listNext;
+
+        if (predicate(it))
+        {
+          _unlink(it, pit);
+          removed++;
+
+          if (pit == it)
+            pit = next;
+        }
+        else
+        {
+          pit = it;
+        }
+
+        it = next;
+      }
+
+      return removed;
+    }
+
+    /////////////////////////////////////////////////
+
+    void free()
+    {
+      while (_root != nullptr)
+      {
+        T* it = _root;
+        _root = _root->_listNext;
+        it->_listNext = nullptr;
+
+        if (_onRemove)
+        {
+          _onRemove(it);
+        }
+      }
+
+      _last   = nullptr;
+      _count  = 0;
     }
 };
 
@@ -336,7 +651,7 @@ class StringArray : public LinkedList<String>
 
     /////////////////////////////////////////////////
 
-    bool containsIgnoreCase(const String& str)
+    bool containsIgnoreCase(const String& str) const
     {
       for (const auto& s : *this)
       {
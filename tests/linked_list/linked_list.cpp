@@ -0,0 +1,290 @@
+// LinkedList and IntrusiveLinkedList : random add and remove sequences must match a std::vector model.
+// Pins down remove() and remove_first() (first match only), remove_if() (every match, in order), count_if(),
+// nth(), front(), length(), iteration order, _onRemove calls, and add() after the tail was removed
+
+#include "Arduino.h"
+#include "StringArray_RP2040W.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+static std::vector<int>  removed;
+static int               failures = 0;
+
+/////////////////////////////////////////////////
+
+static void check(bool ok, const char* what, int step)
+{
+  if (!ok && (failures++ < 10))
+    printf("FAIL %s at step %d\n", what, step);
+}
+
+/////////////////////////////////////////////////
+
+struct Item : public LinkedListHook<Item>
+{
+  int value;
+  bool listed = false;
+};
+
+/////////////////////////////////////////////////
+
+// Same checks for both lists, value() maps a list entry to its int
+template <typename List, typename Value>
+static void compare(const List& list, const std::vector<int>& model, Value value, int step)
+{
+  std::vector<int> seen;
+
+  for (auto entry : list)
+    seen.push_back(value(entry));
+
+  check(seen == model, "iteration", step);
+  check(list.length() == model.size(), "length", step);
+  check(list.isEmpty() == model.empty(), "isEmpty", step);
+  check(list.count_if(nullptr) == model.size(), "count_if(nullptr)", step);
+
+  if (!model.empty())
+    check(value(list.front()) == model.front(), "front", step);
+
+  for (size_t n = 0; n <= model.size(); n++)
+  {
+    auto p = list.nth(n);
+
+    if (n < model.size())
+      check(p && (value(*p) == model[n]), "nth", step);
+    else
+      check(p == nullptr, "nth past the end", step);
+  }
+}
+
+/////////////////////////////////////////////////
+
+static void testLinkedList(std::mt19937& rng)
+{
+  LinkedList<int> list([](const int& v)
+  {
+    removed.push_back(v);
+  });
+
+  std::vector<int> model;
+  auto value = [](int v)
+  {
+    return v;
+  };
+
+  for (int step = 0; step < 20000; step++)
+  {
+    const int v = rng() % 8;
+    auto match = [v](const int& x)
+    {
+      return (x % 3) == (v % 3);
+    };
+
+    removed.clear();
+
+    switch (rng() % 6)
+    {
+      case 0:
+      case 1:
+        list.add(v);
+        model.push_back(v);
+        break;
+
+      case 2:
+      {
+        auto it = std::find(model.begin(), model.end(), v);
+        check(list.remove(v) == (it != model.end()), "remove", step);
+
+        if (it != model.end())
+        {
+          check(removed == std::vector<int> { v }, "remove, onRemove", step);
+          model.erase(it);
+        }
+
+        break;
+      }
+
+      case 3:
+      {
+        auto it = std::find_if(model.begin(), model.end(), match);
+        check(list.remove_first(match) == (it != model.end()), "remove_first", step);
+
+        if (it != model.end())
+        {
+          check(removed == std::vector<int> { *it }, "remove_first, onRemove", step);
+          model.erase(it);
+        }
+
+        break;
+      }
+
+      case 4:
+      {
+        check(list.count_if(match) == (size_t) std::count_if(model.begin(), model.end(), match), "count_if", step);
+
+        // Removing everything now and then empties the list, then add() has to start again from an empty tail
+        if ((rng() % 16) != 0)
+          break;
+
+        std::vector<int> gone;
+        std::copy_if(model.begin(), model.end(), std::back_inserter(gone), match);
+        model.erase(std::remove_if(model.begin(), model.end(), match), model.end());
+
+        check(list.remove_if(match) == gone.size(), "remove_if", step);
+        check(removed == gone, "remove_if, onRemove", step);
+
+        break;
+      }
+
+      case 5:
+        if ((rng() % 64) == 0)
+        {
+          list.free();
+          check(removed == model, "free, onRemove", step);
+          model.clear();
+        }
+
+        break;
+    }
+
+    compare(list, model, value, step);
+  }
+
+  list.free();
+}
+
+/////////////////////////////////////////////////
+
+static void testIntrusiveLinkedList(std::mt19937& rng)
+{
+  std::vector<Item> items(16);
+
+  for (size_t i = 0; i < items.size(); i++)
+    items[i].value = (int) i;
+
+  IntrusiveLinkedList<Item> list([](Item * const& item)
+  {
+    item->listed = false;
+    removed.push_back(item->value);
+  });
+
+  std::vector<int> model;
+  auto value = [](Item * item)
+  {
+    return item->value;
+  };
+
+  for (int step = 0; step < 20000; step++)
+  {
+    Item* item = &items[rng() % items.size()];
+    const int v = item->value;
+    auto match = [v](Item * const& x)
+    {
+      return (x->value % 3) == (v % 3);
+    };
+
+    removed.clear();
+
+    switch (rng() % 6)
+    {
+      case 0:
+      case 1:
+
+        // An item is in one list at a time, and once
+        if (!item->listed)
+        {
+          item->listed = true;
+          list.add(item);
+          model.push_back(v);
+        }
+
+        break;
+
+      case 2:
+      {
+        auto it = std::find(model.begin(), model.end(), v);
+        check(list.remove(item) == (it != model.end()), "intrusive remove", step);
+
+        if (it != model.end())
+        {
+          check(removed == std::vector<int> { v }, "intrusive remove, onRemove", step);
+          model.erase(it);
+        }
+
+        break;
+      }
+
+      case 3:
+      {
+        auto it = std::find_if(model.begin(), model.end(), [v](int x)
+        {
+          return (x % 3) == (v % 3);
+        });
+
+        check(list.remove_first(match) == (it != model.end()), "intrusive remove_first", step);
+
+        if (it != model.end())
+        {
+          check(removed == std::vector<int> { *it }, "intrusive remove_first, onRemove", step);
+          model.erase(it);
+        }
+
+        break;
+      }
+
+      case 4:
+      {
+        auto same = [v](int x)
+        {
+          return (x % 3) == (v % 3);
+        };
+
+        check(list.count_if(match) == (size_t) std::count_if(model.begin(), model.end(), same), "intrusive count_if", step);
+
+        if ((rng() % 16) != 0)
+          break;
+
+        std::vector<int> gone;
+        std::copy_if(model.begin(), model.end(), std::back_inserter(gone), same);
+        model.erase(std::remove_if(model.begin(), model.end(), same), model.end());
+
+        check(list.remove_if(match) == gone.size(), "intrusive remove_if", step);
+        check(removed == gone, "intrusive remove_if, onRemove", step);
+
+        break;
+      }
+
+      case 5:
+        if ((rng() % 64) == 0)
+        {
+          list.free();
+          check(removed == model, "intrusive free, onRemove", step);
+          model.clear();
+        }
+
+        break;
+    }
+
+    compare(list, model, value, step);
+
+    for (const auto& i : items)
+      check(i.listed == (std::find(model.begin(), model.end(), i.value) != model.end()), "intrusive listed", step);
+  }
+
+  list.free();
+}
+
+/////////////////////////////////////////////////
+
+int main()
+{
+  std::mt19937 rng(1);
+
+  testLinkedList(rng);
+  testIntrusiveLinkedList(rng);
+
+  printf("%d failures\n", failures);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+// Host stub of the Arduino core for the tests : String on top of std::string, Print / Stream, no hardware
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <string>
+#include <functional>
+#include <algorithm>
+#define Arduino_h
+#define HEX 16
+#define PGM_P const char*
+#define PROGMEM
+#define strlen_P strlen
+#define memcpy_P memcpy
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper*)(s))
+#define FPSTR(s) ((const __FlashStringHelper*)(s))
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long);
+void yield();
+long random(long);
+class String {
+  std::string s;
+public:
+  String() {}
+  String(const char* c) : s(c ? c : "") {}
+  String(const __FlashStringHelper* c) : s((const char*)c) {}
+  String(char c) : s(1, c) {}
+  String(int v) : s(std::to_string(v)) {}
+  String(unsigned v) : s(std::to_string(v)) {}
+  String(long v) : s(std::to_string(v)) {}
+  String(unsigned long v) : s(std::to_string(v)) {}
+  String(unsigned long long v) : s(std::to_string(v)) {}
+  String(long long v) : s(std::to_string(v)) {}
+  String(unsigned v, unsigned char base) { char b[40]; snprintf(b, 40, base==16?"%x":"%u", v); s=b; }
+  String(double v) : s(std::to_string(v)) {}
+  String(const String&) = default;
+  String(String&&) = default;
+  String& operator=(const String&) = default;
+  String& operator=(String&&) = default;
+  String& operator=(const char* c) { s = c ? c : ""; return *this; }
+  unsigned int length() const { return s.size(); }
+  const char* c_str() const { return s.c_str(); }
+  char* begin() { return &s[0]; }
+  explicit operator bool() const { return true; }
+  bool reserve(unsigned int n) { s.reserve(n); return true; }
+  bool concat(const String& o) { s += o.s; return true; }
+  bool concat(const char* o) { s += o; return true; }
+  bool concat(const char* o, unsigned int n) { s.append(o, n); return true; }
+  bool concat(char c) { s += c; return true; }
+  bool concat(int v) { s += std::to_string(v); return true; }
+  bool concat(unsigned v) { s += std::to_string(v); return true; }
+  bool concat(unsigned long v) { s += std::to_string(v); return true; }
+  String& operator+=(const String& o) { s += o.s; return *this; }
+  String& operator+=(const char* o) { s += o; return *this; }
+  String& operator+=(char c) { s += c; return *this; }
+  String& operator+=(int v) { s += std::to_string(v); return *this; }
+  String& operator+=(unsigned v) { s += std::to_string(v); return *this; }
+  String& operator+=(unsigned long v) { s += std::to_string(v); return *this; }
+  friend String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+  friend String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+  friend String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+  friend String operator+(const String& a, char b) { String r(a); r += b; return r; }
+  bool operator==(const String& o) const { return s == o.s; }
+  bool operator==(const char* o) const { return s == o; }
+  bool operator!=(const String& o) const { return s != o.s; }
+  bool operator!=(const char* o) const { return s != o; }
+  bool operator<(const String& o) const { return s < o.s; }
+  char operator[](unsigned int i) const { return s[i]; }
+  char& operator[](unsigned int i) { return s[i]; }
+  char charAt(unsigned int i) const { return s[i]; }
+  void setCharAt(unsigned int i, char c) { s[i] = c; }
+  bool equals(const String& o) const { return s == o.s; }
+  bool equals(const char* o) const { return s == o; }
+  bool equalsIgnoreCase(const String& o) const { return strcasecmp(s.c_str(), o.c_str()) == 0; }
+  bool startsWith(const String& p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+  bool startsWith(const String& p, unsigned int off) const { return s.size() >= off && s.compare(off, p.s.size(), p.s) == 0; }
+  bool endsWith(const String& p) const { return s.size() >= p.s.size() && s.compare(s.size()-p.s.size(), p.s.size(), p.s) == 0; }
+  int indexOf(char c) const { auto p = s.find(c); return p == std::string::npos ? -1 : (int)p; }
+  int indexOf(char c, unsigned int f) const { auto p = s.find(c, f); return p == std::string::npos ? -1 : (int)p; }
+  int indexOf(const String& c) const { auto p = s.find(c.s); return p == std::string::npos ? -1 : (int)p; }
+  int indexOf(const String& c, unsigned int f) const { auto p = s.find(c.s, f); return p == std::string::npos ? -1 : (int)p; }
+  int lastIndexOf(char c) const { auto p = s.rfind(c); return p == std::string::npos ? -1 : (int)p; }
+  int lastIndexOf(const String& c) const { auto p = s.rfind(c.s); return p == std::string::npos ? -1 : (int)p; }
+  String substring(unsigned int b) const { return b > s.size() ? String() : String(s.substr(b).c_str()); }
+  String substring(unsigned int b, unsigned int e) const { if (b > e) std::swap(b, e); if (b > s.size()) return String(); return String(s.substr(b, e-b).c_str()); }
+  void replace(const String& a, const String& b) { size_t p = 0; while ((p = s.find(a.s, p)) != std::string::npos) { s.replace(p, a.s.size(), b.s); p += b.s.size(); } }
+  void remove(unsigned int i) { s.erase(i); }
+  void remove(unsigned int i, unsigned int n) { s.erase(i, n); }
+  void trim() { while (!s.empty() && isspace((unsigned char)s.back())) s.pop_back(); size_t i = 0; while (i < s.size() && isspace((unsigned char)s[i])) i++; s.erase(0, i); }
+  void toLowerCase() { for (auto& c : s) c = tolower(c); }
+  long toInt() const { return atol(s.c_str()); }
+};
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t* b, size_t n) { size_t r = 0; while (n--) r += write(*b++); return r; }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t write(const char* s, size_t n) { return write((const uint8_t*)s, n); }
+  template<typename T> size_t print(const T&) { return 0; }
+  template<typename T> size_t print(const T&, int) { return 0; }
+  template<typename T> size_t println(const T&) { return 0; }
+  size_t println() { return 0; }
+  size_t printf(const char*, ...) { return 0; }
+};
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual size_t readBytes(char* b, size_t n) { size_t i = 0; while (i < n) { int c = read(); if (c < 0) break; b[i++] = (char)c; } return i; }
+  size_t readBytes(uint8_t* b, size_t n) { return readBytes((char*)b, n); }
+  void setTimeout(unsigned long) {}
+};
+class SerialStub : public Stream { public: size_t write(uint8_t) override { return 1; } int available() override { return 0; } int read() override { return -1; } int peek() override { return -1; } };
+extern SerialStub Serial;
+class IPAddress { public: IPAddress() {} IPAddress(int,int,int,int) {} bool operator==(const IPAddress&) const { return true; } bool operator!=(const IPAddress&) const { return false; } };
+class WiFiClass { public: IPAddress localIP(); };
+extern WiFiClass WiFi;
+#include "FS.h"
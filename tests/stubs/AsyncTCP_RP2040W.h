@@ -0,0 +1,126 @@
+// Host stub of AsyncTCP_RP2040W for the tests : no network, what the library sends is appended to out
+// and received data is injected with recv()
+
+#pragma once
+
+#include "Arduino.h"
+#include <string>
+
+class AsyncClient;
+
+typedef std::function<void(void*, AsyncClient*)>                   AcConnectHandler;
+typedef std::function<void(void*, AsyncClient*, size_t, uint32_t)> AcAckHandler;
+typedef std::function<void(void*, AsyncClient*, int8_t)>           AcErrorHandler;
+typedef std::function<void(void*, AsyncClient*, void*, size_t)>    AcDataHandler;
+typedef std::function<void(void*, AsyncClient*, uint32_t)>         AcTimeoutHandler;
+
+#define ASYNC_WRITE_FLAG_COPY 0x01
+#define ASYNC_WRITE_FLAG_MORE 0x02
+
+class AsyncClient
+{
+  public:
+    std::string out;                  // everything sent
+    bool        closed    = false;
+    size_t      spaceLeft = 1460;     // send window, refill it to let the library send more
+
+    // Receive side acking : bytes held with ackLater(), acked, and acked beyond what was held
+    bool        ackLaterFlag = false;
+    size_t      deferred     = 0;
+    size_t      ackedTotal   = 0;
+    size_t      overAck      = 0;
+
+    AcDataHandler     dataCb;   void* dataArg = 0;
+    AcConnectHandler  discCb;   void* discArg = 0;
+    AcAckHandler      ackCb;    void* ackArg  = 0;
+    AcConnectHandler  pollCb;   void* pollArg = 0;
+
+    // Received data, as lwIP would hand it over
+    void recv(void* data, size_t len)
+    {
+      ackLaterFlag = false;
+      dataCb(dataArg, this, data, len);
+
+      if (ackLaterFlag)
+        deferred += len;
+    }
+
+    size_t add(const char* data, size_t len, uint8_t apiflags = 0)
+    {
+      (void) apiflags;
+
+      if (len > spaceLeft)
+        len = spaceLeft;
+
+      out.append(data, len);
+      spaceLeft -= len;
+
+      return len;
+    }
+
+    size_t write(const char* data, size_t len, uint8_t apiflags = 0) { return add(data, len, apiflags); }
+    size_t write(const char* data) { return write(data, strlen(data)); }
+    bool   send() { return true; }
+    bool   canSend() { return true; }
+    size_t space() { return spaceLeft; }
+
+    void close(bool now = false)
+    {
+      closed = true;
+
+      if (now && discCb)
+        discCb(discArg, this);
+    }
+
+    void ackLater() { ackLaterFlag = true; }
+
+    size_t ack(size_t len)
+    {
+      if (len > deferred)
+      {
+        overAck += len - deferred;
+        len = deferred;
+      }
+
+      deferred   -= len;
+      ackedTotal += len;
+
+      return len;
+    }
+
+    void free() {}
+    void abort() {}
+    bool connected() { return true; }
+    bool freeable() { return true; }
+    void setRxTimeout(uint32_t) {}
+    uint32_t getRxTimeout() { return 0; }
+    void setAckTimeout(uint32_t) {}
+    void setNoDelay(bool) {}
+    uint32_t getMss() { return 1460; }
+    IPAddress localIP() { return IPAddress(); }
+    IPAddress remoteIP() { return IPAddress(); }
+    uint16_t remotePort() { return 0; }
+    const char* stateToString() { return ""; }
+
+    void onConnect(AcConnectHandler, void* = 0) {}
+    void onDisconnect(AcConnectHandler f, void* a = 0) { discCb = f; discArg = a; }
+    void onAck(AcAckHandler f, void* a = 0) { ackCb = f; ackArg = a; }
+    void onError(AcErrorHandler, void* = 0) {}
+    void onData(AcDataHandler f, void* a = 0) { dataCb = f; dataArg = a; }
+    void onTimeout(AcTimeoutHandler, void* = 0) {}
+    void onPoll(AcConnectHandler f, void* a = 0) { pollCb = f; pollArg = a; }
+};
+
+class AsyncServer
+{
+  public:
+    AcConnectHandler  clientCb;
+    void*             clientArg = 0;
+
+    AsyncServer(uint16_t) {}
+
+    void onClient(AcConnectHandler f, void* a) { clientCb = f; clientArg = a; }
+    void begin() {}
+    void end() {}
+    void setNoDelay(bool) {}
+};
@@ -0,0 +1,53 @@
+// Host stub of the FS API for the tests : files are kept in memory, see FS::St
+
+#pragma once
+#include "Arduino.h"
+#include <time.h>
+#include <memory>
+#include <map>
+#include <string>
+#include <cstring>
+#include <algorithm>
+namespace fs {
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+class File : public Stream {
+public:
+  std::shared_ptr<std::string> d; size_t pos=0; std::string nm;
+  File() {}
+  File(const std::string& data, const std::string& n=""): d(std::make_shared<std::string>(data)), nm(n) {}
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t*, size_t n) override { return n; }
+  int available() override { return d ? d->size()-pos : 0; }
+  int read() override { return (d && pos<d->size()) ? (uint8_t)(*d)[pos++] : -1; }
+  int peek() override { return (d && pos<d->size()) ? (uint8_t)(*d)[pos] : -1; }
+  size_t read(uint8_t* b, size_t n) { if(!d) return 0; size_t k=std::min(n,d->size()-pos); memcpy(b,d->data()+pos,k); pos+=k; return k; }
+  bool seek(uint32_t p, SeekMode = SeekSet) { if(!d||p>d->size()) return false; pos=p; return true; }
+  size_t position() const { return pos; }
+  size_t size() const { return d ? d->size() : 0; }
+  void close() {}
+  operator bool() const { return (bool)d; }
+  time_t mtime=0;
+  const char* name() const { return nm.c_str(); }
+  const char* fullName() const { return nm.c_str(); }
+  bool isDirectory() const { return false; }
+  time_t getLastWrite() { return mtime; }
+  void flush() {}
+};
+class Dir { public: bool next() { return false; } String fileName() { return String(); } size_t fileSize() { return 0; } bool isDirectory() { return false; } File openFile(const char*) { return File(); } };
+struct MemFile { std::string data; time_t mtime; };
+class FS {
+public:
+  struct St { std::map<std::string, MemFile> files; int opens=0; }; std::shared_ptr<St> st=std::make_shared<St>();
+  File open(const String& p, const char* m) { return open(p.c_str(), m); }
+  File open(const char* p, const char*) { st->opens++; auto it=st->files.find(p); if(it==st->files.end()) return File(); File f(it->second.data,p); f.mtime=it->second.mtime; return f; }
+  bool exists(const String& p) { return st->files.count(p.c_str()); }
+  bool exists(const char* p) { return st->files.count(p); }
+  bool remove(const String&) { return true; }
+  bool rename(const String&, const String&) { return true; }
+  bool mkdir(const String&) { return true; }
+  bool rmdir(const String&) { return true; }
+  Dir openDir(const String&) { return Dir(); }
+  bool info(void*) { return true; }
+};
+}
+using fs::File; using fs::FS; using fs::Dir; using fs::SeekSet; using fs::SeekCur; using fs::SeekEnd;
@@ -0,0 +1,5 @@
+// Host stub for the tests
+
+#pragma once
+#include "FS.h"
+extern fs::FS LittleFS;
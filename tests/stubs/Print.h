@@ -0,0 +1,4 @@
+// Host stub for the tests
+
+#pragma once
+#include "Arduino.h"
@@ -0,0 +1,5 @@
+// Host stub for the tests
+
+#pragma once
+#include <stddef.h>
+class cbuf { public: cbuf(size_t) {} size_t room() const { return 0; } size_t resizeAdd(size_t) { return 0; } size_t write(const char*, size_t n) { return n; } size_t read(char*, size_t n) { return n; } size_t available() const { return 0; } };
@@ -0,0 +1,38 @@
+// Definitions for the host stubs, and the core functions the library links against
+
+#include "Arduino.h"
+#include <chrono>
+
+unsigned long millis()
+{
+  using namespace std::chrono;
+
+  return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+unsigned long micros()
+{
+  return millis() * 1000;
+}
+
+void delay(unsigned long) {}
+void yield() {}
+
+SerialStub Serial;
+WiFiClass  WiFi;
+
+IPAddress WiFiClass::localIP()
+{
+  return IPAddress();
+}
+
+// BearSSL hashes of the core, only used by the WebSocket handshake and digest authentication
+extern "C"
+{
+  void br_sha1_init(void*) {}
+  void br_sha1_update(void*, const void*, size_t) {}
+  void br_sha1_out(const void*, void*) {}
+  void br_md5_init(void*) {}
+  void br_md5_update(void*, const void*, size_t) {}
+  void br_md5_out(const void*, void*) {}
+}
@@ -0,0 +1,218 @@
+// WebSocket frame parser : the same stream of frames must give the same messages however TCP splits it.
+// The stream covers the 7, 16 and 64 bit payload lengths, random masking keys, and pings between data frames.
+// A control frame longer than 125 bytes must fail the connection with 1002 at any split (RFC 6455 5.5, 7.1.7)
+
+#include "AsyncWebServer_RP2040W.h"
+
+#include <random>
+#include <vector>
+
+static std::vector<std::string>  messages;
+static std::string               current;
+static int                       failures = 0;
+
+/////////////////////////////////////////////////
+
+static void check(bool ok, const char* what, size_t at)
+{
+  if (!ok && (failures++ < 10))
+    printf("FAIL %s at %zu\n", what, at);
+}
+
+/////////////////////////////////////////////////
+
+// Client to server frame, masked as required
+static void appendFrame(std::string& stream, uint8_t opcode, const std::string& payload, uint32_t key)
+{
+  const size_t len = payload.size();
+
+  stream.push_back((char) (0x80 | opcode));
+
+  if (len < 126)
+  {
+    stream.push_back((char) (0x80 | len));
+  }
+  else if (len <= 0xFFFF)
+  {
+    stream.push_back((char) (0x80 | 126));
+    stream.push_back((char) (len >> 8));
+    stream.push_back((char) len);
+  }
+  else
+  {
+    stream.push_back((char) (0x80 | 127));
+
+    for (int i = 7; i >= 0; i--)
+      stream.push_back((char) ((uint64_t) len >> (8 * i)));
+  }
+
+  const uint8_t mask[4] = { (uint8_t) key, (uint8_t) (key >> 8), (uint8_t) (key >> 16), (uint8_t) (key >> 24) };
+
+  stream.append((const char*) mask, 4);
+
+  for (size_t i = 0; i < len; i++)
+    stream.push_back((char) (payload[i] ^ mask[i & 3]));
+}
+
+/////////////////////////////////////////////////
+
+static size_t count(const std::string& haystack, const std::string& needle)
+{
+  size_t n = 0;
+
+  for (size_t pos = haystack.find(needle); pos != std::string::npos; pos = haystack.find(needle, pos + 1))
+    n++;
+
+  return n;
+}
+
+/////////////////////////////////////////////////
+
+// Feed stream to a new connection, cut at the given offsets. Returns what the server sent
+static std::string feed(AsyncWebServer* server, AsyncWebSocket* ws, const std::string& stream, std::vector<size_t> cuts)
+{
+  messages.clear();
+  current.clear();
+
+  AsyncClient* client = new AsyncClient;
+  client->spaceLeft = 1 << 20;
+
+  new AsyncWebSocketClient(new AsyncWebServerRequest(server, client), ws);
+
+  cuts.push_back(stream.size());
+
+  size_t prev = 0;
+
+  for (size_t cut : cuts)
+  {
+    if (cut <= prev)
+      continue;
+
+    // As from lwIP, with a byte after the segment the parser may overwrite and has to restore
+    std::vector<uint8_t> segment(stream.begin() + prev, stream.begin() + cut);
+    segment.push_back(0xEE);
+
+    client->recv(segment.data(), cut - prev);
+    prev = cut;
+  }
+
+  std::string sent = client->out;
+
+  client->close(true);
+
+  return sent;
+}
+
+/////////////////////////////////////////////////
+
+int main()
+{
+  AsyncWebServer* server = new AsyncWebServer(80);
+  AsyncWebSocket* ws     = new AsyncWebSocket("/ws");
+
+  ws->onEvent([](AsyncWebSocket*, AsyncWebSocketClient*, AwsEventType type, void* arg, uint8_t* data, size_t len)
+  {
+    if (type != WS_EVT_DATA)
+      return;
+
+    AwsFrameInfo* info = (AwsFrameInfo*) arg;
+
+    current.append((const char*) data, len);
+
+    if (info->final && (info->index + len == info->len))
+    {
+      messages.push_back(current);
+      current.clear();
+    }
+  });
+
+  std::mt19937 rng(1);
+
+  auto payload = [&rng](size_t len)
+  {
+    std::string p(len, 0);
+
+    for (auto& c : p)
+      c = (char) rng();
+
+    return p;
+  };
+
+  // Small frames, every single split point
+  std::vector<std::string> expected;
+  std::string stream;
+  const std::string pong = std::string("\x8a\x02hi", 4);
+
+  for (size_t len : { 0, 1, 3, 4, 5, 125, 126, 127, 300, 1000, 7 })
+  {
+    expected.push_back(payload(len));
+    appendFrame(stream, (len & 1) ? WS_TEXT : WS_BINARY, expected.back(), rng());
+
+    if (len == 3 || len == 126)
+      appendFrame(stream, WS_PING, "hi", rng());
+  }
+
+  for (size_t at = 0; at < stream.size(); at++)
+  {
+    std::string sent = feed(server, ws, stream, { at });
+
+    check(messages == expected, "small frames, split", at);
+    check(count(sent, pong) == 2, "small frames, pongs", at);
+  }
+
+  // One byte at a time
+  std::vector<size_t> everyByte;
+
+  for (size_t at = 1; at < stream.size(); at++)
+    everyByte.push_back(at);
+
+  feed(server, ws, stream, everyByte);
+  check(messages == expected, "small frames, byte by byte", 0);
+
+  // 16 and 64 bit lengths, random splits
+  std::vector<std::string> bigExpected;
+  std::string bigStream;
+
+  for (size_t len : { 65535, 65536, 70001 })
+  {
+    bigExpected.push_back(payload(len));
+    appendFrame(bigStream, WS_BINARY, bigExpected.back(), rng());
+    appendFrame(bigStream, WS_PING, "hi", rng());
+  }
+
+  for (int run = 0; run < 200; run++)
+  {
+    std::vector<size_t> cuts;
+    const size_t step = (run % 3 == 0) ? 4 : (run % 3 == 1) ? 40 : 3000;
+
+    for (size_t at = 1 + rng() % step; at < bigStream.size(); at += 1 + rng() % step)
+      cuts.push_back(at);
+
+    std::string sent = feed(server, ws, bigStream, cuts);
+
+    check(messages == bigExpected, "big frames, random split", run);
+    check(count(sent, pong) == 3, "big frames, pongs", run);
+  }
+
+  // Oversized ping : 1002 close, and the text frame after it is ignored
+  std::string bad;
+
+  appendFrame(bad, WS_PING, payload(200), rng());
+  appendFrame(bad, WS_TEXT, "after", rng());
+
+  for (size_t at = 0; at < bad.size(); at++)
+  {
+    std::string sent = feed(server, ws, bad, { at });
+
+    check((sent.size() >= 4) && ((uint8_t) sent[0] == 0x88) && (sent[2] == 0x03) && (sent[3] == (char) 0xEA),
+          "oversized ping, close 1002", at);
+    check(messages.empty(), "oversized ping, data after", at);
+  }
+
+  delete ws;
+  delete server;
+
+  printf("%zu + %zu bytes, %d failures\n", stream.size(), bigStream.size(), failures);
+
+  return failures ? 1 : 0;
+}